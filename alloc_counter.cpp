@@ -0,0 +1,45 @@
+#include "alloc_counter.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef FMT_COUNT_ALLOCS
+
+// initial-exec so that reading it never has to allocate the thread's storage, which would call back into here.
+static thread_local uint64_t threadAllocs __attribute__((tls_model("initial-exec"))) = 0;
+
+uint64_t AllocCounter::getThreadCount()
+{
+    return threadAllocs;
+}
+
+// The replacements. new[] and the nothrow versions go through this one. The aligned versions are left alone: they
+// are rare and the library's own use malloc/free the same as these.
+void *operator new(std::size_t size)
+{
+    ++threadAllocs;
+    void *ptr = std::malloc((size == 0) ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#else
+
+uint64_t AllocCounter::getThreadCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts the calls to the global operator new, per thread. Only in builds with FMT_COUNT_ALLOCS defined (make DEBUG=1),
+// where alloc_counter.cpp replaces operator new. Other builds keep the standard one and always count 0.
+// This is how we check that formatting, once it has warmed up, doesn't allocate per value: take the count before and
+// after, on the thread that did the work.
+class AllocCounter {
+public:
+    static bool isEnabled()
+    {
+#ifdef FMT_COUNT_ALLOCS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Calls to operator new made by the calling thread so far
+    static uint64_t getThreadCount();
+};
@@ -1,13 +1,13 @@
 #include "ascii_type.h"
-#include <iomanip>
 #include <string>
-#include <sstream>
+#include <tuple>
 #include "fmt_exception.h"
+#include "fmt_kernels.h"
 #include "fmt_type.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
 
 
-AsciiType::AsciiType(FmtTool *parent) : FmtType(parent)
+AsciiType::AsciiType(const FmtFormatter *parent) : FmtType(parent)
 {
 }
 
@@ -17,17 +17,34 @@ std::string AsciiType::toString() const
     return retStr;
 }
 
-void AsciiType::format(std::vector<FmtColumn> &formattedCols, const std::string &value)
+// The characters are shown as the hex value of each one, run together after a single 0x. Every character is always 2
+// digits (0x09 shows as 09, 0xff as ff), so the text can be read back a byte at a time.
+size_t AsciiType::hexLength(std::string_view value)
 {
-    std::stringstream ss;
-    std::string formattedData;
-    ss << "0x" << std::hex;
-    for (int i = 0; i < value.size();  ++i) {
-        ss << static_cast<int>(value[i]);
+    return 2 + value.size() * 2;  // 0x, then 2 digits per character
+}
+
+void AsciiType::writeHex(char *dst, std::string_view value)
+{
+    // The encoder kernel does a vector's worth of characters per step, so long lines go through in a single pass.
+    dst[0] = '0';
+    dst[1] = 'x';
+    FmtKernels::encodeHex(dst + 2, value.data(), value.size());
+}
+
+FmtType::ResultCounts AsciiType::formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const
+{
+    // The hex text is written straight into the column. Any text is valid.
+    FmtColumnData &hexCol = cols[0];
+    for (size_t i = 0; i < count; ++i) {
+        writeHex(hexCol.appendCell(hexLength(values[i])), values[i]);
     }
-    formattedData = ss.str();
-    formattedCols.emplace_back(formattedData, formattedData.size());
+    return ResultCounts();
+}
 
+FmtType::FormatBatchFn AsciiType::getFormatBatchFn() const
+{
+    return &AsciiType::formatBatchFn;
 }
 
 void AsciiType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
@@ -42,3 +59,9 @@ void AsciiType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vec
     titleRow2.emplace_back(widthName, widthName.size());
     underscoreRow.emplace_back("", BASE_16.size());
 }
+
+void AsciiType::getColumnWidths(std::vector<size_t> &maxWidths) const
+{
+    // The hex string grows with the length of the input string, so there is no upper bound.
+    maxWidths.push_back(0);
+}
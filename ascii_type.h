@@ -1,17 +1,22 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
-#include <iostream>
 #include <string>
+#include <string_view>
 #include "fmt_type.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
 
 class AsciiType : public FmtType {
 public:
-    AsciiType(FmtTool *parent);
+    AsciiType(const FmtFormatter *parent);
     ~AsciiType() = default;
     std::string toString() const override;
-    void format(std::vector<FmtType::FmtColumn> &formattedCols, const std::string &value) override;
+    ResultCounts formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const override;
+    FormatBatchFn getFormatBatchFn() const override;
+    size_t getColumnCount() const override
+    {
+        return 1;
+    }
     size_t getCompareHash() const override
     {
         // Unlike the IntType which supports things like -i 16 -i 32 where you can have more than
@@ -23,6 +28,17 @@ public:
     }
     void getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
                      std::vector<FmtType::FmtColumn> &underscoreRow) const override;
+    void getColumnWidths(std::vector<size_t> &maxWidths) const override;
 private:
+    // The hex text of the value's characters, "0x" included. hexLength() says how much space writeHex() needs.
+    static size_t hexLength(std::string_view value);
+    static void writeHex(char *dst, std::string_view value);
+
+    // Qualified calls, so there is no virtual dispatch.
+    static ResultCounts formatBatchFn(const FmtType &fmtType, const std::string_view *values, size_t count,
+                                      FmtColumnData *cols)
+    {
+        return static_cast<const AsciiType &>(fmtType).AsciiType::formatBatch(values, count, cols);
+    }
 
 };
@@ -1,13 +1,13 @@
 #include "binary_type.h"
-#include <iomanip>
 #include <string>
-#include <sstream>
+#include <tuple>
 #include "fmt_exception.h"
+#include "fmt_kernels.h"
 #include "fmt_type.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
 
 
-BinaryType::BinaryType(FmtTool *parent) : FmtType(parent)
+BinaryType::BinaryType(const FmtFormatter *parent) : FmtType(parent)
 {
 }
 
@@ -17,42 +17,46 @@ std::string BinaryType::toString() const
     return retStr;
 }
 
-void BinaryType::format(std::vector<FmtColumn> &formattedCols, const std::string &value)
+bool BinaryType::isValidInput(std::string_view value)
 {
-    const int MAX_STR_LEN = 160; // limit the length of input string to 160 characters (80 bytes)
-    // Data must start with 0x and have even number of bytes. Otherwise it is not valid.
-    if (value.compare(0,2, "0x") != 0 || (value.size() % 2 != 0) || value.size() > MAX_STR_LEN ) {
-        formattedCols.emplace_back(INVALID, INVALID.size());
-        return;
-    }
-
-    std::stringstream ss;  // build the string in this stream
+    // Data must start with 0x and have even number of bytes. Otherwise it is not valid. There is no limit on the
+    // length: a whole packet capture's worth of hex is fine.
+    return value.compare(0,2, "0x") == 0 && (value.size() % 2 == 0);
+}
 
+bool BinaryType::decode(char *dst, std::string_view value)
+{
     // length is already sanity checked to be even, and starts with 0x.
-    // iterate every 2 characters to get the bytes.
+    // The decoding kernel turns each pair of hex digits into its byte and checks the digits, a vector at a time.
     // example 0x123456 is processing 12, 34, 56  (as hex numbers)
-    // std::stoi() has built in logic to parse hex digits and convert to the numeric format.
-    // so for example, "0x55" as a string will return the decimal number 85 as an int
-    // This is what we want, and then cast it to its ascii char.
-    for (size_t i = 2; i < value.size(); i +=2) {
-        std::string byteStr = value.substr(i, 2);
-        int charAsInt = std::stoi(byteStr, nullptr, 16);
-        // Sanity check that the byte falls within the range of printable ascii characters.
-        // If it does not, then we will write a white space character in its place
-        // Here for printable characters we'll use extended ascii that goes up to 0xff.
-        // No support for different multi-byte characters and codepages. Seems my own terminal isn't showing
-        // UTF-8 anyway, not sure how to fix it.
-        if (charAsInt > 31 && charAsInt < 256) {
-            ss << static_cast<char>(charAsInt);
+    // A byte that isn't a printable character is written as a white space character in its place. Here for printable
+    // characters we'll use extended ascii that goes up to 0xff.
+    // No support for different multi-byte characters and codepages. Seems my own terminal isn't showing
+    // UTF-8 anyway, not sure how to fix it.
+    return FmtKernels::decodeHex(dst, value.data() + 2, (value.size() - 2) / 2);
+}
+
+FmtType::ResultCounts BinaryType::formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const
+{
+    // The decoded characters are written straight into the column. Bad digits are only found while decoding, so the
+    // cell is only added once the decode has worked.
+    ResultCounts results;
+    FmtColumnData &asciiCol = cols[0];
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = (values[i].size() - 2) / 2;
+        if (isValidInput(values[i]) && decode(asciiCol.getCellBuffer(len), values[i])) {
+            asciiCol.commitCell(len);
         } else {
-            ss << " ";
+            asciiCol.append(INVALID);
+            ++results.invalid;
         }
     }
+    return results;
+}
 
-    std::string formattedData;
-    formattedData = ss.str();
-    formattedCols.emplace_back(formattedData, formattedData.size());
-
+FmtType::FormatBatchFn BinaryType::getFormatBatchFn() const
+{
+    return &BinaryType::formatBatchFn;
 }
 
 void BinaryType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
@@ -67,3 +71,9 @@ void BinaryType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::ve
     titleRow2.emplace_back(widthName, widthName.size());
     underscoreRow.emplace_back("", ASCII.size());
 }
+
+void BinaryType::getColumnWidths(std::vector<size_t> &maxWidths) const
+{
+    // The decoded string grows with the length of the input data, so there is no upper bound.
+    maxWidths.push_back(0);
+}
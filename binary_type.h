@@ -1,17 +1,22 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
-#include <iostream>
 #include <string>
+#include <string_view>
 #include "fmt_type.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
 
 class BinaryType : public FmtType {
 public:
-    BinaryType(FmtTool *parent);
+    BinaryType(const FmtFormatter *parent);
     ~BinaryType() = default;
     std::string toString() const override;
-    void format(std::vector<FmtType::FmtColumn> &formattedCols, const std::string &value) override;
+    ResultCounts formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const override;
+    FormatBatchFn getFormatBatchFn() const override;
+    size_t getColumnCount() const override
+    {
+        return 1;
+    }
     size_t getCompareHash() const override
     {
         // Unlike the IntType which supports things like -i 16 -i 32 where you can have more than
@@ -23,6 +28,20 @@ public:
     }
     void getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
                      std::vector<FmtType::FmtColumn> &underscoreRow) const override;
+    void getColumnWidths(std::vector<size_t> &maxWidths) const override;
 private:
+    // Input must be 0x followed by whole bytes (pairs of hex digits). This checks the 0x and the length. The digits
+    // themselves are checked by decode(), as it goes.
+    static bool isValidInput(std::string_view value);
+    // Writes the (value.size() - 2) / 2 characters decoded from an input that passed isValidInput(). Returns false if
+    // it holds anything that isn't a hex digit.
+    static bool decode(char *dst, std::string_view value);
+
+    // Qualified calls, so there is no virtual dispatch.
+    static ResultCounts formatBatchFn(const FmtType &fmtType, const std::string_view *values, size_t count,
+                                      FmtColumnData *cols)
+    {
+        return static_cast<const BinaryType &>(fmtType).BinaryType::formatBatch(values, count, cols);
+    }
 
 };
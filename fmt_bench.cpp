@@ -0,0 +1,343 @@
+// Microbenchmarks for the formatting types and the result table display.
+//
+// Usage: fmtbench [-t <min seconds per case>] [name filter]
+//
+// Every case prints one line of comma separated values to stdout, with a header line first:
+//     name,iterations,total_ns,ns_per_op
+// The int, ascii and binary cases format one value per FmtType::formatBatch() call (what a -serve request of one value
+// or FmtFormatter::formatValue() does). The /batch cases give it a whole pool at a time.
+// An "op" is one value formatted (or one row, for the table cases). The names and the column layout are kept stable
+// so results can be diffed from one build to the next.
+// In a make DEBUG=1 build, the heap allocations per op of each case are also shown, on stderr.
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+#include "alloc_counter.h"
+#include "ascii_type.h"
+#include "binary_type.h"
+#include "fmt_column.h"
+#include "fmt_exception.h"
+#include "fmt_formatter.h"
+#include "fmt_tool.h"
+#include "fmt_type.h"
+#include "input_tokenizer.h"
+#include "int_type.h"
+
+static const size_t POOL_SIZE = 1024;  // distinct inputs per case, cycled through
+
+static double minSeconds = 0.2;
+static std::string nameFilter;
+
+// Runs the op in a growing number of iterations until one run takes at least minSeconds, then reports that run.
+// op(iterations) does at least `iterations` operations and returns how many it really did.
+static void runCase(const std::string &name, const std::function<size_t(size_t)> &op)
+{
+    if (!nameFilter.empty() && name.find(nameFilter) == std::string::npos) {
+        return;
+    }
+    op(POOL_SIZE);  // warm up caches and any lazily built state
+
+    size_t iterations = POOL_SIZE;
+    while (true) {
+        uint64_t startAllocs = AllocCounter::getThreadCount();
+        auto start = std::chrono::steady_clock::now();
+        iterations = op(iterations);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        uint64_t allocs = AllocCounter::getThreadCount() - startAllocs;
+        double seconds = elapsed.count() / 1e9;
+        if (seconds >= minSeconds || iterations >= (size_t(1) << 34)) {
+            std::printf("%s,%zu,%" PRId64 ",%.2f\n", name.c_str(), iterations, static_cast<int64_t>(elapsed.count()),
+                        static_cast<double>(elapsed.count()) / iterations);
+            std::fflush(stdout);
+            if (AllocCounter::isEnabled()) {
+                std::fprintf(stderr, "%s: %.4f allocations per op\n", name.c_str(),
+                             static_cast<double>(allocs) / iterations);
+            }
+            return;
+        }
+        // aim a bit past the target so we don't creep up on it one doubling at a time
+        double scale = (seconds > 0) ? (minSeconds * 1.2 / seconds) : 8.0;
+        iterations = static_cast<size_t>(iterations * std::min(std::max(scale, 2.0), 100.0));
+    }
+}
+
+// Formats every input of the pool through the type, round robin, iterations times, one value per batch. The columns
+// keep their buffers from one value to the next.
+static void benchFormat(const std::string &name, FmtType &fmtType, const std::vector<std::string> &pool)
+{
+    std::vector<std::string_view> values(pool.begin(), pool.end());
+    std::vector<FmtColumnData> cols(fmtType.getColumnCount());
+    runCase(name, [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; ++i) {
+            for (auto &col : cols) {
+                col.clear();
+            }
+            fmtType.formatBatch(&values[i % values.size()], 1, cols.data());
+        }
+        return iterations;
+    });
+}
+
+// Same as benchFormat(), but through formatBatch() a whole pool at a time.
+static void benchFormatBatch(const std::string &name, FmtType &fmtType, const std::vector<std::string> &pool)
+{
+    std::vector<std::string_view> values(pool.begin(), pool.end());
+    std::vector<FmtColumnData> cols(fmtType.getColumnCount());
+    runCase(name, [&](size_t iterations) {
+        size_t done = 0;
+        for (; done < iterations; done += values.size()) {
+            for (auto &col : cols) {
+                col.clear();
+            }
+            fmtType.formatBatch(values.data(), values.size(), cols.data());
+        }
+        return done;
+    });
+}
+
+static std::string toHex(uint64_t value, size_t numBytes)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::string hexStr = "0x";
+    for (size_t i = numBytes * 2; i > 0; --i) {
+        hexStr += HEX_DIGITS[(value >> ((i - 1) * 4)) & 0xf];
+    }
+    return hexStr;
+}
+
+static void benchIntTypes(FmtFormatter &formatter, std::mt19937_64 &rng)
+{
+    const std::vector<std::string> JUNK = {"abc", "zz12", "-", "x0x0", "hello", "+", "0xg1", "garbage_token"};
+    for (size_t width : {8, 16, 32, 64}) {
+        for (bool isSigned : {true, false}) {
+            IntType intType(width, isSigned, &formatter);
+            std::string prefix = "int/" + intType.toString() + "/";
+            uint64_t mask = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+
+            std::vector<std::string> decValid;
+            std::vector<std::string> hexValid;
+            std::vector<std::string> outOfRange;
+            std::vector<std::string> invalid;
+            for (size_t i = 0; i < POOL_SIZE; ++i) {
+                uint64_t bits = rng() & mask;
+                if (isSigned) {
+                    // sign extend the random bits to get an in range signed value
+                    int64_t signedValue = (width == 64) ? static_cast<int64_t>(bits)
+                                                        : static_cast<int64_t>(bits << (64 - width)) >> (64 - width);
+                    decValid.push_back(std::to_string(signedValue));
+                } else {
+                    decValid.push_back(std::to_string(bits));
+                }
+                hexValid.push_back(toHex(bits, width / 8));
+                if (width == 64) {
+                    outOfRange.push_back("1" + std::to_string(rng() % 1000000) + "0000000000000000000");
+                } else {
+                    outOfRange.push_back(std::to_string((1ULL << width) + (rng() % 100000)));
+                }
+                invalid.push_back(JUNK[i % JUNK.size()]);
+            }
+            benchFormat(prefix + "dec_valid", intType, decValid);
+            benchFormat(prefix + "hex_valid", intType, hexValid);
+            benchFormat(prefix + "out_of_range", intType, outOfRange);
+            benchFormat(prefix + "invalid", intType, invalid);
+            benchFormatBatch(prefix + "dec_valid/batch", intType, decValid);
+            benchFormatBatch(prefix + "hex_valid/batch", intType, hexValid);
+        }
+    }
+}
+
+static std::string randomText(std::mt19937_64 &rng, size_t length)
+{
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        text += static_cast<char>(' ' + rng() % 95);  // printable ascii
+    }
+    return text;
+}
+
+static void benchStringTypes(FmtFormatter &formatter, std::mt19937_64 &rng)
+{
+    AsciiType asciiType(&formatter);
+    BinaryType binaryType(&formatter);
+    for (size_t length : {8, 80, 4096}) {
+        std::vector<std::string> asciiPool;
+        std::vector<std::string> binaryPool;
+        for (size_t i = 0; i < POOL_SIZE / 8; ++i) {
+            std::string text = randomText(rng, length);
+            std::string hexText = "0x";
+            for (char c : text) {
+                hexText += toHex(static_cast<unsigned char>(c), 1).substr(2);
+            }
+            asciiPool.push_back(text);
+            binaryPool.push_back(hexText);
+        }
+        benchFormat("ascii/len" + std::to_string(length), asciiType, asciiPool);
+        benchFormat("binary/bytes" + std::to_string(length), binaryType, binaryPool);
+        benchFormatBatch("ascii/len" + std::to_string(length) + "/batch", asciiType, asciiPool);
+        benchFormatBatch("binary/bytes" + std::to_string(length) + "/batch", binaryType, binaryPool);
+    }
+}
+
+// The library entry point: one value at a time into a caller buffer, the way an embedding program would call it.
+static void benchFormatter(std::mt19937_64 &rng)
+{
+    FmtFormatter formatter;
+    formatter.addIntType(32, true);
+    formatter.addIntType(64, false);
+    std::vector<std::string> pool;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        pool.push_back(std::to_string(static_cast<int32_t>(rng())));
+    }
+    char buf[256];
+    runCase("lib/format_value", [&](size_t iterations) {
+        size_t total = 0;
+        for (size_t i = 0; i < iterations; ++i) {
+            total += formatter.formatValue(pool[i % pool.size()], buf, sizeof(buf));
+        }
+        if (total == 0) {
+            THROW_FMT_EXCEPTION("Nothing was formatted");
+        }
+        return iterations;
+    });
+
+    // A batch at a time through more and more int widths, the last being -i 8 -i 16 -i 32 -i 64 -u 32 -u 64. The
+    // values are parsed once for all of the widths, so each added width should only cost its own range check and
+    // rendering.
+    std::vector<std::string_view> values(pool.begin(), pool.end());
+    const std::pair<size_t, bool> widths[] = {{8, true}, {16, true}, {32, true}, {64, true}, {32, false}, {64, false}};
+    for (size_t numWidths : {1, 2, 4, 6}) {
+        FmtFormatter widthsFormatter;
+        for (size_t i = 0; i < numWidths; ++i) {
+            widthsFormatter.addIntType(widths[i].first, widths[i].second);
+        }
+        std::vector<FmtColumnData> cols(widthsFormatter.getColumnCount());
+        runCase("lib/batch_int_widths_" + std::to_string(numWidths), [&](size_t iterations) {
+            size_t done = 0;
+            for (; done < iterations; done += values.size()) {
+                for (auto &col : cols) {
+                    col.clear();
+                }
+                widthsFormatter.formatBatch(values.data(), values.size(), cols.data());
+            }
+            return done;
+        });
+    }
+}
+
+// Splitting text into values, as the -f and stdin input do. An op is one value. There is one value per line, so both
+// modes find the same values.
+static void benchTokenizer(std::mt19937_64 &rng)
+{
+    std::string text;
+    size_t numValues = 0;
+    while (text.size() < 1024 * 1024) {
+        text += std::to_string(static_cast<int32_t>(rng())) + "\n";
+        ++numValues;
+    }
+    std::vector<std::string_view> values;
+    values.reserve(numValues);
+    for (auto mode : {InputTokenizer::Mode::TOKENS, InputTokenizer::Mode::LINES}) {
+        std::string name = (mode == InputTokenizer::Mode::TOKENS) ? "input/tokens" : "input/lines";
+        runCase(name, [&](size_t iterations) {
+            size_t done = 0;
+            for (; done < iterations; done += numValues) {
+                values.clear();
+                InputTokenizer::split(text, mode, values);
+                if (values.size() != numValues) {
+                    THROW_FMT_EXCEPTION("Wrong number of values from the tokenizer");
+                }
+            }
+            return done;
+        });
+    }
+}
+
+// The full table path: format into the result table, then display it. The input comes from a temporary file (-f) so
+// that the arg parsing isn't part of the timing. The output goes to /dev/null.
+static void benchTable(std::mt19937_64 &rng)
+{
+    const size_t NUM_ROWS = 100000;
+    char inFileName[] = "/tmp/fmtbench_XXXXXX";
+    int inFd = mkstemp(inFileName);
+    if (inFd < 0) {
+        THROW_FMT_EXCEPTION("Unable to create a temporary input file");
+    }
+    std::string userValues;
+    for (size_t i = 0; i < NUM_ROWS; ++i) {
+        userValues += std::to_string(static_cast<int32_t>(rng())) + "\n";
+    }
+    bool written = (write(inFd, userValues.data(), userValues.size()) == static_cast<ssize_t>(userValues.size()));
+    close(inFd);
+    int devNull = open("/dev/null", O_WRONLY);
+    if (!written || devNull < 0) {
+        unlink(inFileName);
+        THROW_FMT_EXCEPTION("Unable to set up the table benchmark files");
+    }
+
+    // Formatting and display are timed separately. The op count is in rows, rounded up to whole tables.
+    auto makeTool = [&]() {
+        auto tool = std::make_unique<FmtTool>(devNull);
+        std::stringstream args("-i 32 -u 64 -a -f " + std::string(inFileName));
+        tool->parseArgs(&args);
+        return tool;
+    };
+    runCase("table/format_100k_rows", [&](size_t iterations) {
+        size_t done = 0;
+        for (; done < iterations; done += NUM_ROWS) {
+            makeTool()->executeFormatting();
+        }
+        return done;
+    });
+
+    // Display doesn't change the table, so one prepared table is displayed over and over.
+    auto preparedTool = makeTool();
+    preparedTool->executeFormatting();
+    runCase("table/display_100k_rows", [&](size_t iterations) {
+        size_t done = 0;
+        for (; done < iterations; done += NUM_ROWS) {
+            preparedTool->displayResultTable();
+        }
+        return done;
+    });
+    close(devNull);
+    unlink(inFileName);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            minSeconds = std::atof(argv[++i]);
+        } else {
+            nameFilter = arg;
+        }
+    }
+
+    try {
+        FmtFormatter formatter;  // the settings (binary column on) for the types built in the benchmarks
+        std::mt19937_64 rng(12345);  // fixed seed, so every run benchmarks the same inputs
+
+        std::printf("name,iterations,total_ns,ns_per_op\n");
+        benchIntTypes(formatter, rng);
+        benchStringTypes(formatter, rng);
+        benchFormatter(rng);
+        benchTokenizer(rng);
+        benchTable(rng);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "fmt_cache.h"
+#include <functional>
+#include "fmt_exception.h"
+
+const size_t FmtCache::NO_ENTRY = static_cast<size_t>(-1);
+
+FmtCache::FmtCache(size_t capacity, size_t numCols)
+    : capacity_(capacity), numCols_(numCols), numEntries_(0), clockHand_(0), hits_(0), misses_(0), evictions_(0)
+{
+    if (capacity_ == 0 || capacity_ > UINT32_MAX / 2) {
+        THROW_FMT_EXCEPTION("Invalid cache size (-cache <entries>).");
+    }
+    // At least twice as many slots as entries keeps the probe runs short.
+    size_t numSlots = 16;
+    while (numSlots < capacity_ * 2) {
+        numSlots *= 2;
+    }
+    mask_ = numSlots - 1;
+    slots_.assign(numSlots, Slot{0, 0});
+    entries_.resize(capacity_);
+    cellEnds_.resize(capacity_ * numCols_);
+}
+
+size_t FmtCache::findSlot(std::string_view key, size_t hash) const
+{
+    // Returns the slot holding the key, or the empty slot where it would go.
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    size_t slot = hash & mask_;
+    while (slots_[slot].entry != 0) {
+        if (slots_[slot].tag == tag) {
+            const Entry &ent = entries_[slots_[slot].entry - 1];
+            if (std::string_view(ent.data.data(), ent.keyLen) == key) {
+                return slot;
+            }
+        }
+        slot = (slot + 1) & mask_;
+    }
+    return slot;
+}
+
+size_t FmtCache::find(std::string_view key, size_t hash)
+{
+    size_t slot = findSlot(key, hash);
+    if (slots_[slot].entry == 0) {
+        ++misses_;
+        return NO_ENTRY;
+    }
+    ++hits_;
+    size_t entry = slots_[slot].entry - 1;
+    entries_[entry].referenced = true;
+    return entry;
+}
+
+void FmtCache::insert(std::string_view key, const FmtColumnData *cols, size_t row)
+{
+    size_t hash = hashKey(key);
+    if (slots_[findSlot(key, hash)].entry != 0) {
+        return;  // already here
+    }
+    size_t entry = takeEntry();
+
+    // Fill the entry. The string keeps its capacity from whatever was here before.
+    Entry &ent = entries_[entry];
+    ent.data.assign(key.data(), key.size());
+    ent.hash = hash;
+    ent.keyLen = static_cast<uint32_t>(key.size());
+    ent.referenced = false;  // not until it is hit. Tokens that are only ever seen once go first.
+    uint32_t *ends = &cellEnds_[entry * numCols_];
+    for (size_t col = 0; col < numCols_; ++col) {
+        std::string_view cell = cols[col].getCell(row);
+        ent.data.append(cell.data(), cell.size());
+        ends[col] = static_cast<uint32_t>(ent.data.size());
+    }
+
+    // The empty slot must be looked up again, since taking the entry may have shifted slots around.
+    size_t slot = findSlot(key, hash);
+    slots_[slot].entry = static_cast<uint32_t>(entry + 1);
+    slots_[slot].tag = static_cast<uint32_t>(hash >> 32);
+}
+
+size_t FmtCache::takeEntry()
+{
+    // A never used entry while there are some, then CLOCK.
+    if (numEntries_ < capacity_) {
+        return numEntries_++;
+    }
+    while (entries_[clockHand_].referenced) {
+        entries_[clockHand_].referenced = false;
+        clockHand_ = (clockHand_ + 1) % capacity_;
+    }
+    size_t victim = clockHand_;
+    clockHand_ = (clockHand_ + 1) % capacity_;
+
+    // Find the victim's slot by its hash and index, and take it out of the table.
+    size_t slot = entries_[victim].hash & mask_;
+    while (slots_[slot].entry != victim + 1) {
+        slot = (slot + 1) & mask_;
+    }
+    removeSlot(slot);
+    ++evictions_;
+    return victim;
+}
+
+void FmtCache::removeSlot(size_t slot)
+{
+    // Backward shift deletion: move later members of the probe run back into the hole, so no tombstones are needed
+    // and lookups never have to probe past a deleted slot.
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask_;
+    while (slots_[next].entry != 0) {
+        size_t home = entries_[slots_[next].entry - 1].hash & mask_;
+        // The slot at next can move into the hole unless its home lies cyclically in (hole, next].
+        bool homeInRange = (hole <= next) ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!homeInRange) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+        next = (next + 1) & mask_;
+    }
+    slots_[hole] = Slot{0, 0};
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fmt_column.h"
+
+// A bounded cache of formatted rows, keyed by the input token (the -cache option). A hit hands back the cells of
+// every output column, so a repeated token costs one hash lookup and a copy instead of running the formatters again.
+//
+// The hash table is flat open addressing with linear probing. Its slots only hold an entry index and a few bits of
+// the hash, so a probe touches little memory and the key is only compared when those bits match. The entries
+// themselves live in a fixed array of capacity entries, each keeping its key and cells back to back in one string
+// that is reused when the entry is replaced.
+// When full, the entry to replace is chosen with the CLOCK algorithm: a hand sweeps the entries, giving a second chance
+// to any that were hit since it last passed, and takes the first one that wasn't.
+//
+// Not thread safe. The caller must lock around it when it is shared.
+class FmtCache {
+public:
+    static const size_t NO_ENTRY;
+
+    FmtCache(size_t capacity, size_t numCols);
+    ~FmtCache() = default;
+
+    static size_t hashKey(std::string_view key)
+    {
+        return std::hash<std::string_view>()(key);
+    }
+
+    // Returns the entry for the key, or NO_ENTRY. Counts as a hit or a miss. hash is hashKey(key).
+    size_t find(std::string_view key, size_t hash);
+    size_t find(std::string_view key)
+    {
+        return find(key, hashKey(key));
+    }
+
+    // Counts a hit that the caller served itself: a repeat of a key it already has the cells of (for example one
+    // that missed earlier in the same batch and isn't inserted yet).
+    void countHit()
+    {
+        ++hits_;
+    }
+
+    // The cells of an entry, only valid until the next insert()
+    std::string_view getCell(size_t entry, size_t col) const
+    {
+        const Entry &ent = entries_[entry];
+        const uint32_t *ends = &cellEnds_[entry * numCols_];
+        size_t start = (col == 0) ? ent.keyLen : ends[col - 1];
+        return std::string_view(ent.data.data() + start, ends[col] - start);
+    }
+
+    // Stores the key with row `row` of the given columns (numCols of them). Does nothing if the key is already here.
+    void insert(std::string_view key, const FmtColumnData *cols, size_t row);
+
+    uint64_t getHits() const
+    {
+        return hits_;
+    }
+
+    uint64_t getMisses() const
+    {
+        return misses_;
+    }
+
+    uint64_t getEvictions() const
+    {
+        return evictions_;
+    }
+
+private:
+    struct Entry {
+        std::string data;        // the key, then each cell, back to back
+        size_t hash = 0;
+        uint32_t keyLen = 0;
+        bool referenced = false; // hit since the clock hand last passed
+    };
+
+    struct Slot {
+        uint32_t entry;  // entry index + 1. 0 is an empty slot
+        uint32_t tag;    // high bits of the hash
+    };
+
+    size_t findSlot(std::string_view key, size_t hash) const;
+    size_t takeEntry();
+    void removeSlot(size_t slot);
+
+    size_t capacity_;
+    size_t numCols_;
+    size_t mask_;                     // slot count - 1 (the slot count is a power of 2)
+    std::vector<Slot> slots_;
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> cellEnds_;  // numCols_ per entry: where each cell ends in the entry's data
+    size_t numEntries_;
+    size_t clockHand_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+};
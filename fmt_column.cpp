@@ -0,0 +1,54 @@
+#include "fmt_column.h"
+#include <algorithm>
+#include <cstring>
+
+FmtColumnData::FmtColumnData() : used_(0), capacity_(0), maxWidth_(0)
+{
+    offsets_.push_back(0);
+}
+
+void FmtColumnData::clear()
+{
+    used_ = 0;
+    offsets_.resize(1);
+    maxWidth_ = 0;
+}
+
+void FmtColumnData::reserve(size_t numCells, size_t numBytes)
+{
+    // Doubled like the data, so a column that is filled a chunk at a time doesn't reallocate for every chunk.
+    size_t numOffsets = offsets_.size() + numCells;
+    if (numOffsets > offsets_.capacity()) {
+        offsets_.reserve(std::max(numOffsets, offsets_.capacity() * 2));
+    }
+    if (used_ + numBytes > capacity_) {
+        grow(used_ + numBytes);
+    }
+}
+
+void FmtColumnData::appendColumn(const FmtColumnData &other)
+{
+    // One copy for all of the text, then the other column's offsets are shifted to start where our data ends.
+    reserve(other.size(), other.used_);
+    if (other.used_ > 0) {
+        std::memcpy(data_.get() + used_, other.data_.get(), other.used_);
+    }
+    size_t base = used_;
+    for (size_t i = 1; i < other.offsets_.size(); ++i) {
+        offsets_.push_back(base + other.offsets_[i]);
+    }
+    used_ += other.used_;
+    widen(other.maxWidth_);
+}
+
+void FmtColumnData::grow(size_t minCapacity)
+{
+    // Double each time so that appending is amortized constant time.
+    size_t newCapacity = std::max({minCapacity, capacity_ * 2, static_cast<size_t>(256)});
+    std::unique_ptr<char[]> newData(new char[newCapacity]);
+    if (used_ > 0) {
+        std::memcpy(newData.get(), data_.get(), used_);
+    }
+    data_ = std::move(newData);
+    capacity_ = newCapacity;
+}
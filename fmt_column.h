@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// One column of formatted cells. All of the cell text is kept back to back in a single character buffer, with an
+// array of offsets to find where each cell ends. The widest cell is tracked as cells are added.
+// This is the output of FmtType::formatBatch() (one FmtColumnData per output column of the type) and also the storage
+// of each column in the ResultTable.
+class FmtColumnData {
+public:
+    FmtColumnData();
+    ~FmtColumnData() = default;
+    FmtColumnData(FmtColumnData &&) = default;
+    FmtColumnData &operator=(FmtColumnData &&) = default;
+
+    // Drops all cells but keeps the memory for reuse. The max width starts over at 0.
+    void clear();
+
+    // Make room for more cells and bytes of cell data ahead of time.
+    void reserve(size_t numCells, size_t numBytes);
+
+    void append(std::string_view cell)
+    {
+        char *dst = appendCell(cell.size());
+        std::copy(cell.begin(), cell.end(), dst);
+    }
+
+    // Adds a cell of the given length and returns where its text must be written. Lets a formatter render straight
+    // into the column. The pointer is only good until the next append.
+    char *appendCell(size_t len)
+    {
+        char *dst = getCellBuffer(len);
+        commitCell(len);
+        return dst;
+    }
+
+    // appendCell() in two steps, for a formatter that only finds out while rendering whether the cell is any good.
+    // getCellBuffer() makes room for a cell of len and returns where to write it, but adds nothing. commitCell() then
+    // adds the cell that was written there. If it isn't called, the next cell simply takes the same space.
+    char *getCellBuffer(size_t len)
+    {
+        if (used_ + len > capacity_) {
+            grow(used_ + len);
+        }
+        return data_.get() + used_;
+    }
+
+    void commitCell(size_t len)
+    {
+        used_ += len;
+        offsets_.push_back(used_);
+        if (len > maxWidth_) {
+            maxWidth_ = len;
+        }
+    }
+
+    // Appends every cell of the other column
+    void appendColumn(const FmtColumnData &other);
+
+    // Makes the tracked width at least the given width (for titles, which are not cells)
+    void widen(size_t width)
+    {
+        if (width > maxWidth_) {
+            maxWidth_ = width;
+        }
+    }
+
+    size_t size() const
+    {
+        return offsets_.size() - 1;
+    }
+
+    size_t getMaxWidth() const
+    {
+        return maxWidth_;
+    }
+
+    std::string_view getCell(size_t i) const
+    {
+        return std::string_view(data_.get() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    // The text of all of the cells, back to back
+    std::string_view getAllCells() const
+    {
+        return std::string_view(data_.get(), used_);
+    }
+
+private:
+    void grow(size_t minCapacity);
+
+    std::unique_ptr<char[]> data_;  // cell text, back to back. Not zero filled, so appends don't pay for that.
+    size_t used_;
+    size_t capacity_;
+    std::vector<size_t> offsets_;   // cell i is [offsets_[i], offsets_[i+1]) in data_. Starts with a single 0.
+    size_t maxWidth_;
+};
@@ -0,0 +1,227 @@
+// Writes a synthetic input corpus for fmttool to stdout, for the end to end runs of perf.sh.
+//
+// Usage: fmtcorpus [-size <bytes>] [-mix <kind>=<weight>,...] [-repeat <percent>] [-seed <n>]
+//
+// -size is the amount of text to write, with an optional k, m or g suffix (powers of 1024). The default is 16m.
+// -mix sets how often each kind of token comes up, relative to the others. The kinds are:
+//     dec      a decimal number of 1 to 64 bits
+//     hex      0x and the digits of 1 to 8 bytes (exactly 2 per byte, so the hex-negative rule comes into play)
+//     neg      a negative decimal number of 1 to 64 bits
+//     range    a number too big for any of the int types (decimal or hex)
+//     invalid  text that no int type takes
+//     ascii    a word of 1 to 16 letters and digits
+//     blob     0x and the hex digits of 1 to 32 bytes, for -b
+// Kinds that aren't given have a weight of 0. The default is dec=40,hex=20,neg=15,range=10,invalid=5,ascii=5,blob=5.
+// -repeat is the percent chance that a token is a copy of one of the last few thousand, instead of a new one (for
+// -cache). The default is 0.
+// -seed picks the random sequence. The same args always give the same corpus.
+// The tokens are separated by spaces, 16 to a line.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+enum class TokenKind : int8_t {DEC, HEX, NEG, RANGE, INVALID, ASCII, BLOB, NUM_KINDS};
+
+static const char *const KIND_NAMES[] = {"dec", "hex", "neg", "range", "invalid", "ascii", "blob"};
+static const size_t REPEAT_WINDOW = 4096;    // a repeated token is one of this many recent tokens
+static const size_t TOKENS_PER_LINE = 16;
+static const size_t WRITE_SIZE = 1024 * 1024;  // text is written out in pieces of about this size
+
+static std::mt19937_64 rng;
+
+static uint64_t randomBelow(uint64_t limit)
+{
+    return rng() % limit;
+}
+
+static void appendHexDigits(std::string &token, uint64_t value, size_t numBytes)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (size_t i = numBytes * 2; i > 0; --i) {
+        token += HEX_DIGITS[(value >> ((i - 1) * 4)) & 0xf];
+    }
+}
+
+// A random number of 1 to 64 bits, so the small values (which the narrow int types take) come up as often as the
+// big ones.
+static uint64_t randomBits()
+{
+    size_t numBits = 1 + randomBelow(64);
+    return rng() >> (64 - numBits);
+}
+
+static void makeToken(TokenKind kind, std::string &token)
+{
+    static const char WORD_CHARS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    static const std::vector<std::string> JUNK = {"abc", "12ab", "--5", "0x", "0xzz", "+-1", "x0x0", "1.5", "-",
+                                                  "garbage_token"};
+    token.clear();
+    switch (kind) {
+        case (TokenKind::DEC): {
+            token = std::to_string(randomBits());
+            break;
+        }
+        case (TokenKind::HEX): {
+            token = "0x";
+            appendHexDigits(token, rng(), 1 + randomBelow(8));
+            break;
+        }
+        case (TokenKind::NEG): {
+            token = "-" + std::to_string(randomBits() >> 1);
+            break;
+        }
+        case (TokenKind::RANGE): {
+            // Past 64 bits: 20 to 25 decimal digits starting with a 2 or more, or 17 to 20 hex digits.
+            if (randomBelow(2) == 0) {
+                token = std::to_string(2 + randomBelow(8));
+                for (size_t i = 19 + randomBelow(6); i > 0; --i) {
+                    token += static_cast<char>('0' + randomBelow(10));
+                }
+            } else {
+                token = "0x";
+                appendHexDigits(token, 1 + randomBelow(0xfff), 2);
+                appendHexDigits(token, rng(), 8);
+            }
+            break;
+        }
+        case (TokenKind::INVALID): {
+            token = JUNK[randomBelow(JUNK.size())];
+            break;
+        }
+        case (TokenKind::ASCII): {
+            for (size_t i = 1 + randomBelow(16); i > 0; --i) {
+                token += WORD_CHARS[randomBelow(sizeof(WORD_CHARS) - 1)];
+            }
+            break;
+        }
+        case (TokenKind::BLOB): {
+            token = "0x";
+            for (size_t i = 1 + randomBelow(32); i > 0; --i) {
+                appendHexDigits(token, rng(), 1);
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+// Reads a size in bytes with an optional k, m or g suffix. Returns false if it isn't one.
+static bool parseSize(const std::string &text, size_t &bytes)
+{
+    char *end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str()) {
+        return false;
+    }
+    std::string suffix(end);
+    size_t shift = 0;
+    if (suffix == "k" || suffix == "K") {
+        shift = 10;
+    } else if (suffix == "m" || suffix == "M") {
+        shift = 20;
+    } else if (suffix == "g" || suffix == "G") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        return false;
+    }
+    bytes = static_cast<size_t>(value) << shift;
+    return true;
+}
+
+// Reads "kind=weight,kind=weight,..." into weights. Returns false if any of it doesn't parse.
+static bool parseMix(const std::string &text, std::vector<unsigned> &weights)
+{
+    weights.assign(static_cast<size_t>(TokenKind::NUM_KINDS), 0);
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        std::string item = text.substr(pos, (end == std::string::npos) ? std::string::npos : end - pos);
+        pos = (end == std::string::npos) ? text.size() : end + 1;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        size_t kind = 0;
+        while (kind < weights.size() && item.compare(0, eq, KIND_NAMES[kind]) != 0) {
+            ++kind;
+        }
+        char *weightEnd = nullptr;
+        unsigned long weight = std::strtoul(item.c_str() + eq + 1, &weightEnd, 10);
+        if (kind == weights.size() || weightEnd == item.c_str() + eq + 1 || *weightEnd != '\0') {
+            return false;
+        }
+        weights[kind] = static_cast<unsigned>(weight);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    size_t size = 16 * 1024 * 1024;
+    std::vector<unsigned> weights;
+    parseMix("dec=40,hex=20,neg=15,range=10,invalid=5,ascii=5,blob=5", weights);
+    unsigned repeatPercent = 0;
+    unsigned long long seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool ok = (i + 1 < argc);
+        if (ok && arg == "-size") {
+            ok = parseSize(argv[++i], size);
+        } else if (ok && arg == "-mix") {
+            ok = parseMix(argv[++i], weights);
+        } else if (ok && arg == "-repeat") {
+            repeatPercent = static_cast<unsigned>(std::atoi(argv[++i]));
+            ok = (repeatPercent <= 100);
+        } else if (ok && arg == "-seed") {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "Usage: fmtcorpus [-size <bytes>] [-mix <kind>=<weight>,...] [-repeat <percent>] "
+                                 "[-seed <n>]\n");
+            return 1;
+        }
+    }
+    if (std::all_of(weights.begin(), weights.end(), [](unsigned weight) { return weight == 0; })) {
+        std::fprintf(stderr, "fmtcorpus: the -mix needs at least one kind with a weight above 0\n");
+        return 1;
+    }
+    std::discrete_distribution<size_t> kindDist(weights.begin(), weights.end());
+    rng.seed(seed);
+
+    // The recent tokens are kept in a ring for -repeat
+    std::vector<std::string> recent(REPEAT_WINDOW);
+    size_t numRecent = 0;
+    std::string text;
+    std::string token;
+    text.reserve(WRITE_SIZE + 1024);
+    size_t written = 0;
+    size_t numTokens = 0;
+    while (written + text.size() < size) {
+        if (numRecent > 0 && randomBelow(100) < repeatPercent) {
+            token = recent[randomBelow(std::min(numRecent, REPEAT_WINDOW))];
+        } else {
+            makeToken(static_cast<TokenKind>(kindDist(rng)), token);
+            recent[numRecent % REPEAT_WINDOW] = token;
+            ++numRecent;
+        }
+        text += token;
+        text += (++numTokens % TOKENS_PER_LINE == 0) ? '\n' : ' ';
+        if (text.size() >= WRITE_SIZE) {
+            std::fwrite(text.data(), 1, text.size(), stdout);
+            written += text.size();
+            text.clear();
+        }
+    }
+    text += '\n';
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    return (std::fflush(stdout) == 0) ? 0 : 1;
+}
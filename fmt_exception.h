@@ -1,6 +1,6 @@
 #pragma once
 
-#include <iostream>
+#include <string>
 #include <stdexcept>
 
 #define THROW_FMT_EXCEPTION(msg) \
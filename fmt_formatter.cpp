@@ -0,0 +1,242 @@
+#include "fmt_formatter.h"
+#include <algorithm>
+#include <utility>
+#include "ascii_type.h"
+#include "binary_type.h"
+#include "fmt_exception.h"
+#include "int_type.h"
+
+void FmtFormatter::addIntType(size_t width, bool isSigned)
+{
+    insertFmtType(std::make_unique<IntType>(width, isSigned, this));
+}
+
+void FmtFormatter::addAsciiType()
+{
+    insertFmtType(std::make_unique<AsciiType>(this));
+}
+
+void FmtFormatter::addBinaryType()
+{
+    insertFmtType(std::make_unique<BinaryType>(this));
+}
+
+void FmtFormatter::setBinaryFmtSuppressed(bool noBin)
+{
+    // This changes the number of int columns, so the plan must be redone.
+    noBin_ = noBin;
+    compilePlan();
+}
+
+void FmtFormatter::insertFmtType(std::unique_ptr<FmtType> newType)
+{
+    fmtTypes_.insert(std::move(newType));  // std::set eliminates duplicates
+    compilePlan();
+}
+
+void FmtFormatter::compilePlan()
+{
+    // Resolve the batch format function of each format type once, up front, along with where its columns go. The
+    // loop in formatBatch() then just walks a flat array and calls straight into the template instance for each type.
+    plan_.clear();
+    numIntSteps_ = 0;
+    size_t col = 0;
+    for (const auto &fmtType : fmtTypes_) {
+        const IntType *intType = dynamic_cast<const IntType *>(fmtType.get());
+        plan_.push_back({fmtType->getFormatBatchFn(), fmtType.get(), col, intType});
+        col += fmtType->getColumnCount();
+        if (intType != nullptr) {
+            ++numIntSteps_;
+        }
+    }
+    numCols_ = col;
+}
+
+void FmtFormatter::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
+                               std::vector<FmtType::FmtColumn> &underscoreRow) const
+{
+    for (const auto &fmtType : fmtTypes_) {
+        fmtType->getTitleRow(titleRow1, titleRow2, underscoreRow);
+    }
+}
+
+void FmtFormatter::getColumnWidths(std::vector<size_t> &maxWidths) const
+{
+    for (const auto &fmtType : fmtTypes_) {
+        fmtType->getColumnWidths(maxWidths);
+    }
+}
+
+void FmtFormatter::getFmtTypeNames(std::vector<std::string> &names) const
+{
+    for (const auto &fmtType : fmtTypes_) {
+        names.push_back(fmtType->toString());
+    }
+}
+
+// The scratch that one chunk of values takes for each int type: its numbers and their error codes, aligned
+static const size_t CHUNK_SCRATCH_PER_TYPE = 256 * (sizeof(uint64_t) + sizeof(IntType::ErrType)) +
+                                             2 * alignof(std::max_align_t);
+
+void FmtFormatter::formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols, FmtStats *stats,
+                               std::pmr::memory_resource *scratch) const
+{
+    // for each format type request, drive the formatting against the whole batch of data. Each format type fills in
+    // its own columns, one column at a time. The int types are done together at the end, see formatIntSteps().
+    // Timed a whole batch at a time, so it is two clock reads per type per batch.
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        const PlanStep &step = plan_[i];
+        if (step.intType != nullptr) {
+            continue;
+        }
+        FmtStats::Clock::time_point start;
+        if (stats != nullptr) {
+            start = FmtStats::Clock::now();
+        }
+        FmtType::ResultCounts results = step.formatBatchFn(*step.fmtType, values, count, cols + step.firstCol);
+        if (stats != nullptr) {
+            stats->addTypeTime(i, FmtStats::nsSince(start), count);
+            addResults(i, count, results, *stats);
+        }
+    }
+    if (numIntSteps_ > 0) {
+        if (scratch != nullptr) {
+            formatIntSteps(values, count, cols, stats, scratch);
+        } else {
+            alignas(std::max_align_t) char stackBuf[SCRATCH_SIZE];
+            std::pmr::monotonic_buffer_resource stackArena(stackBuf, sizeof(stackBuf));
+            formatIntSteps(values, count, cols, stats, &stackArena);
+        }
+    }
+}
+
+void FmtFormatter::formatIntSteps(const std::string_view *values, size_t count, FmtColumnData *cols,
+                                  FmtStats *stats, std::pmr::memory_resource *scratch) const
+{
+    static_assert(256 == INT_PARSE_CHUNK, "CHUNK_SCRATCH_PER_TYPE is sized for a chunk of 256");
+    static_assert(INT_PARSE_CHUNK * sizeof(IntType::ParsedInt) + MAX_INT_TYPES * CHUNK_SCRATCH_PER_TYPE +
+                  2 * alignof(std::max_align_t) <= SCRATCH_SIZE, "SCRATCH_SIZE is too small for a chunk");
+    // Each int type used to parse every value for itself, so -i 8 -i 16 -i 32 -i 64 parsed the same text 4 times.
+    // Now the values are parsed once into a form that every width can range check (see IntType::ParsedInt), and each
+    // int type renders its columns from that. The parse is shared by all of them, so adding more widths only adds
+    // their range checks and rendering.
+    // The parsed values of a chunk, and the space that the int types take their numbers from while they render it.
+    // Both come out of the batch's scratch. The int types' space is an arena of its own that starts over for every
+    // chunk, so a big batch needs no more than a small one.
+    std::pmr::vector<IntType::ParsedInt> parsed(INT_PARSE_CHUNK, scratch);
+    const size_t chunkScratchSize = numIntSteps_ * CHUNK_SCRATCH_PER_TYPE;
+    std::pmr::vector<std::max_align_t> chunkScratch(chunkScratchSize / sizeof(std::max_align_t) + 1, scratch);
+    uint64_t parseNs = 0;
+    uint64_t intNs[MAX_INT_TYPES] = {};
+    FmtType::ResultCounts intResults[MAX_INT_TYPES];
+    for (size_t first = 0; first < count; first += INT_PARSE_CHUNK) {
+        size_t chunkSize = (count - first < INT_PARSE_CHUNK) ? count - first : INT_PARSE_CHUNK;
+        FmtStats::Clock::time_point start;
+        if (stats != nullptr) {
+            start = FmtStats::Clock::now();
+        }
+        IntType::parseBatch(values + first, chunkSize, parsed.data());
+        std::pmr::monotonic_buffer_resource chunkArena(chunkScratch.data(), chunkScratchSize, scratch);
+        if (stats != nullptr) {
+            parseNs += FmtStats::nsSince(start);
+        }
+        size_t k = 0;
+        for (const auto &step : plan_) {
+            if (step.intType == nullptr) {
+                continue;
+            }
+            if (stats != nullptr) {
+                start = FmtStats::Clock::now();
+            }
+            FmtType::ResultCounts results = step.intType->formatParsedBatch(parsed.data(), chunkSize,
+                                                                            cols + step.firstCol, &chunkArena);
+            if (stats != nullptr) {
+                intNs[k] += FmtStats::nsSince(start);
+                intResults[k].outOfRange += results.outOfRange;
+                intResults[k].invalid += results.invalid;
+            }
+            ++k;
+        }
+    }
+
+    // The shared parse is split evenly over the int types in the stats.
+    if (stats != nullptr) {
+        size_t k = 0;
+        for (size_t i = 0; i < plan_.size(); ++i) {
+            if (plan_[i].intType != nullptr) {
+                stats->addTypeTime(i, intNs[k] + parseNs / numIntSteps_, count);
+                addResults(i, count, intResults[k], *stats);
+                ++k;
+            }
+        }
+    }
+}
+
+void FmtFormatter::formatRawBatch(const uint64_t *rawValues, const std::string_view *values, size_t count,
+                                  size_t rawBits, FmtColumnData *cols, FmtStats *stats,
+                                  std::pmr::memory_resource *scratch) const
+{
+    alignas(std::max_align_t) char stackBuf[CHUNK_SCRATCH_PER_TYPE];
+    std::pmr::monotonic_buffer_resource stackArena(stackBuf, sizeof(stackBuf));
+    if (scratch == nullptr) {
+        scratch = &stackArena;
+    }
+    // A type at a time, a chunk at a time, each chunk with an arena of its own over the same space (as in
+    // formatIntSteps())
+    std::pmr::vector<std::max_align_t> chunkScratch(CHUNK_SCRATCH_PER_TYPE / sizeof(std::max_align_t) + 1, scratch);
+    for (size_t i = 0; i < plan_.size(); ++i) {
+        const PlanStep &step = plan_[i];
+        FmtStats::Clock::time_point start;
+        if (stats != nullptr) {
+            start = FmtStats::Clock::now();
+        }
+        FmtType::ResultCounts results;
+        for (size_t first = 0; first < count; first += INT_PARSE_CHUNK) {
+            size_t chunkSize = (count - first < INT_PARSE_CHUNK) ? count - first : INT_PARSE_CHUNK;
+            std::pmr::monotonic_buffer_resource chunkArena(chunkScratch.data(), CHUNK_SCRATCH_PER_TYPE, scratch);
+            FmtType::ResultCounts chunkResults = step.fmtType->formatRawBatch(rawValues + first, values + first,
+                                                                              chunkSize, rawBits,
+                                                                              cols + step.firstCol, &chunkArena);
+            results.outOfRange += chunkResults.outOfRange;
+            results.invalid += chunkResults.invalid;
+        }
+        if (stats != nullptr) {
+            stats->addTypeTime(i, FmtStats::nsSince(start), count);
+            addResults(i, count, results, *stats);
+        }
+    }
+}
+
+void FmtFormatter::addResults(size_t typeIdx, size_t count, const FmtType::ResultCounts &results, FmtStats &stats)
+{
+    // The types only count what failed. Everything else was valid.
+    stats.addTypeResults(typeIdx, count - results.outOfRange - results.invalid, results.outOfRange, results.invalid);
+}
+
+size_t FmtFormatter::formatValue(std::string_view value, char *buf, size_t bufSize, char sep)
+{
+    // A batch of one, into our own columns. Then the cells are copied out to the caller's buffer.
+    if (valueCols_.size() != numCols_) {
+        valueCols_.clear();
+        valueCols_.resize(numCols_);
+    }
+    for (auto &col : valueCols_) {
+        col.clear();
+    }
+    formatBatch(&value, 1, valueCols_.data());
+
+    size_t len = 0;
+    auto copyOut = [&](std::string_view text) {
+        if (len < bufSize) {
+            std::copy_n(text.data(), std::min(text.size(), bufSize - len), buf + len);
+        }
+        len += text.size();
+    };
+    for (size_t col = 0; col < valueCols_.size(); ++col) {
+        if (col > 0) {
+            copyOut(std::string_view(&sep, 1));
+        }
+        copyOut(valueCols_[col].getCell(0));
+    }
+    return len;
+}
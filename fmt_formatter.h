@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string_view>
+#include <vector>
+#include "fmt_column.h"
+#include "fmt_stats.h"
+#include "fmt_type.h"
+
+class IntType;
+
+// A template specialization for std::less so that std::set can work with unique ptr's but uses
+// the object itself for positioning and comparisons in the set.
+template<>
+struct std::less<std::unique_ptr<FmtType>> {
+    bool operator()(const std::unique_ptr<FmtType> &a, const std::unique_ptr<FmtType> &b) const {
+        return *a < *b;
+    }
+};
+
+// The formatting engine on its own, without any of the command line tool around it. This is the entry point of
+// libfmttool for programs that want to format values in process instead of running fmttool.
+// Configure the format types once, then format values (one at a time into a char buffer, or in batches into
+// FmtColumnData columns). Nothing here reads or writes any stream, and errors are thrown as FmtException.
+//
+// The output columns are the same as fmttool's table minus the input column: each format type's columns, in the same
+// order as the table shows them (see getTitleRow()).
+class FmtFormatter {
+public:
+    FmtFormatter() = default;
+    ~FmtFormatter() = default;
+    // The format types keep a pointer back to us, so no copies.
+    FmtFormatter(const FmtFormatter &) = delete;
+    FmtFormatter &operator=(const FmtFormatter &) = delete;
+
+    // Same as the -i/-u, -a, -b and -nobin options of fmttool. Adding a type that is already there does nothing.
+    void addIntType(size_t width, bool isSigned);
+    void addAsciiType();
+    void addBinaryType();
+    void setBinaryFmtSuppressed(bool noBin);
+
+    bool IsBinaryFmtSuppressed() const {
+        return noBin_;
+    }
+
+    bool hasFmtTypes() const
+    {
+        return !fmtTypes_.empty();
+    }
+
+    // Number of output columns, over all of the format types
+    size_t getColumnCount() const
+    {
+        return numCols_;
+    }
+
+    // Appends the title columns of every format type. See FmtType::getTitleRow().
+    void getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
+                     std::vector<FmtType::FmtColumn> &underscoreRow) const;
+
+    // Appends the max width of every output column. See FmtType::getColumnWidths().
+    void getColumnWidths(std::vector<size_t> &maxWidths) const;
+
+    // Appends the name of every format type (for example "int16_t"), in column order. For FmtStats::initTypes().
+    void getFmtTypeNames(std::vector<std::string> &names) const;
+
+    // Formats count values. cols must point at getColumnCount() columns, owned by the caller. One cell per value is
+    // appended to each (the columns are not cleared first). The columns can be cleared and reused from one call to
+    // the next, so that a steady stream of batches doesn't allocate.
+    // This only reads our settings, so several threads may call it at once, each with their own columns.
+    // If stats is given, the time spent in each format type and its valid, out of range and invalid result counts are
+    // added to it (see getFmtTypeNames()). Each thread must have its own.
+    // The buffers that only live for the batch (the parsed values and such) come from scratch, which should be reset
+    // from one batch to the next: fmttool gives each thread an arena over a buffer of SCRATCH_SIZE that it starts over
+    // for every batch. The values are worked through in chunks, so that is enough for a batch of any size. Without
+    // scratch, they come from the stack.
+    void formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols, FmtStats *stats = nullptr,
+                     std::pmr::memory_resource *scratch = nullptr) const;
+
+    // The same for binary records. See FmtType::formatRawBatch() for what rawValues and values hold.
+    void formatRawBatch(const uint64_t *rawValues, const std::string_view *values, size_t count, size_t rawBits,
+                        FmtColumnData *cols, FmtStats *stats = nullptr,
+                        std::pmr::memory_resource *scratch = nullptr) const;
+
+    // Bytes of scratch that formatBatch() and formatRawBatch() take from the caller's scratch, at most
+    static const size_t SCRATCH_SIZE = 32 * 1024;
+
+    // Formats a single value into buf as one line of text: the output columns separated by sep, no line end and no
+    // null terminator. Returns the full length of the line. If that is more than bufSize then only the first
+    // bufSize characters were written, so the caller can grow the buffer and call again (like snprintf).
+    // Reuses internal buffers, so there is no allocation once they have grown to size. For that reason this is not
+    // safe to call from several threads on the same object; use formatBatch() with per-thread columns instead.
+    size_t formatValue(std::string_view value, char *buf, size_t bufSize, char sep = ' ');
+
+private:
+    void insertFmtType(std::unique_ptr<FmtType> newType);
+    void compilePlan();
+    // formatBatch() for all of the int types at once
+    void formatIntSteps(const std::string_view *values, size_t count, FmtColumnData *cols, FmtStats *stats,
+                        std::pmr::memory_resource *scratch) const;
+    // Adds a batch's result counts for one format type to stats
+    static void addResults(size_t typeIdx, size_t count, const FmtType::ResultCounts &results, FmtStats &stats);
+
+    std::set<std::unique_ptr<FmtType>> fmtTypes_;
+
+    // The format plan: fmtTypes_ flattened into an array, in the same order, with each entry's batch format function
+    // already resolved and the index of its first output column. This is what runs for every batch of values. The
+    // set is only used for setup and titles. It is rebuilt whenever the settings change.
+    // The int types don't use their formatBatchFn here. They share one parse of the values instead (see formatBatch()).
+    struct PlanStep {
+        FmtType::FormatBatchFn formatBatchFn;
+        const FmtType *fmtType;
+        size_t firstCol;
+        const IntType *intType;  // the same type, if it is an int type. Otherwise null.
+    };
+    // Values are parsed for the int types this many at a time, small enough that the parsed values stay in the cache
+    // while every int type goes over them.
+    static const size_t INT_PARSE_CHUNK = 256;
+    static const size_t MAX_INT_TYPES = 8;  // 4 widths, signed and unsigned
+
+    std::vector<PlanStep> plan_;
+    size_t numIntSteps_ = 0;
+    size_t numCols_ = 0;
+    bool noBin_ = false;
+    std::vector<FmtColumnData> valueCols_;  // formatValue() only: the columns of the single value
+};
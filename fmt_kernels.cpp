@@ -0,0 +1,497 @@
+#include "fmt_kernels.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Scalar versions. These work everywhere and are the reference for what the vector versions must produce.
+
+static void writeHexScalar(char *dst, uint64_t value, size_t numBytes)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (size_t i = numBytes * 2; i > 0; --i) {
+        dst[i - 1] = HEX_DIGITS[value & 0xf];
+        value >>= 4;
+    }
+}
+
+static void writeBinScalar(char *dst, uint64_t value, size_t numBits)
+{
+    for (size_t i = numBits; i > 0; --i) {
+        dst[i - 1] = static_cast<char>('0' + (value & 1));
+        value >>= 1;
+    }
+}
+
+// Records are read byte by byte, so this works the same on any host byte order.
+static void loadRecordsScalar(uint64_t *dst, const char *src, size_t count, size_t numBytes, bool bigEndian)
+{
+    for (size_t i = 0; i < count; ++i, src += numBytes) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < numBytes; ++b) {
+            size_t shift = (bigEndian) ? (numBytes - 1 - b) * 8 : b * 8;
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(src[b])) << shift;
+        }
+        dst[i] = value;
+    }
+}
+
+// The 2 hex digits of every byte value, back to back: "000102...feff"
+struct HexEncodeTable {
+    char digitPairs[512];
+
+    constexpr HexEncodeTable() : digitPairs()
+    {
+        const char hexDigits[] = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i) {
+            digitPairs[i * 2] = hexDigits[i >> 4];
+            digitPairs[i * 2 + 1] = hexDigits[i & 0xf];
+        }
+    }
+};
+
+static constexpr HexEncodeTable HEX_ENCODE_TABLE;
+
+static void encodeHexScalar(char *dst, const char *src, size_t numBytes)
+{
+    for (size_t i = 0; i < numBytes; ++i) {
+        std::memcpy(dst + i * 2, &HEX_ENCODE_TABLE.digitPairs[static_cast<unsigned char>(src[i]) * 2], 2);
+    }
+}
+
+// The lookup tables of the hex decoder: the value of each hex digit character (0xff for anything that isn't one),
+// and the character shown for each byte value.
+struct HexDecodeTables {
+    uint8_t digitValue[256];
+    char printable[256];
+
+    constexpr HexDecodeTables() : digitValue(), printable()
+    {
+        for (int i = 0; i < 256; ++i) {
+            digitValue[i] = 0xff;
+            // Control characters would mess up the table, so they show as a space. Everything from 0x20 up (extended
+            // ascii included) is shown as is.
+            printable[i] = static_cast<char>((i < 0x20) ? ' ' : i);
+        }
+        for (int i = 0; i < 10; ++i) {
+            digitValue['0' + i] = static_cast<uint8_t>(i);
+        }
+        for (int i = 0; i < 6; ++i) {
+            digitValue['a' + i] = static_cast<uint8_t>(10 + i);
+            digitValue['A' + i] = static_cast<uint8_t>(10 + i);
+        }
+    }
+};
+
+static constexpr HexDecodeTables HEX_DECODE_TABLES;
+
+static bool decodeHexScalar(char *dst, const char *src, size_t numBytes)
+{
+    // The bad digit flags are ORed together and checked once at the end, so the loop has no branches.
+    uint8_t bad = 0;
+    for (size_t i = 0; i < numBytes; ++i) {
+        uint8_t hi = HEX_DECODE_TABLES.digitValue[static_cast<unsigned char>(src[i * 2])];
+        uint8_t lo = HEX_DECODE_TABLES.digitValue[static_cast<unsigned char>(src[i * 2 + 1])];
+        bad |= hi | lo;
+        dst[i] = HEX_DECODE_TABLES.printable[((hi << 4) | lo) & 0xff];
+    }
+    return (bad & 0xf0) == 0;
+}
+
+static inline bool isSpaceChar(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static size_t scanSpaceScalar(const char *src, size_t n, bool wantSpace)
+{
+    size_t i = 0;
+    while (i < n && isSpaceChar(src[i]) != wantSpace) {
+        ++i;
+    }
+    return i;
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of the x86-64 baseline, so these need no special compiler flags.
+
+static void writeHexSse2(char *dst, uint64_t value, size_t numBytes)
+{
+    // Shift the bytes we want up to the top, then byte swap so the most significant byte lands first in memory.
+    if (numBytes < 8) {
+        value <<= (64 - numBytes * 8);
+    }
+    __m128i bytes = _mm_cvtsi64_si128(static_cast<long long>(__builtin_bswap64(value)));
+
+    // Split every byte into its 2 nibbles and interleave them, high nibble first. That gives 16 values of 0..15 in
+    // output order.
+    const __m128i lowMask = _mm_set1_epi8(0x0f);
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask);
+    __m128i loNibbles = _mm_and_si128(bytes, lowMask);
+    __m128i nibbles = _mm_unpacklo_epi8(hiNibbles, loNibbles);
+
+    // '0' + n for the digits, and another ('a' - '0' - 10) on top of that for the letters.
+    __m128i letterFix = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+    __m128i digits = _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letterFix);
+
+    alignas(16) char buf[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(buf), digits);
+    std::memcpy(dst, buf, numBytes * 2);
+}
+
+// Expands 2 bytes into 16 characters. The first byte is spread over the low 8 lanes, the second over the high 8.
+static inline __m128i binCharsSse2(uint32_t firstByte, uint32_t secondByte)
+{
+    const __m128i bitMask = _mm_setr_epi8(static_cast<char>(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                          static_cast<char>(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m128i x = _mm_cvtsi32_si128(static_cast<int>(firstByte | (secondByte << 8)));
+    x = _mm_unpacklo_epi8(x, x);   // f f s s
+    x = _mm_unpacklo_epi16(x, x);  // f x4, s x4
+    x = _mm_unpacklo_epi32(x, x);  // f x8, s x8
+    // Lanes with their bit set compare to all ones (-1), and '0' - (-1) is '1'.
+    __m128i isSet = _mm_cmpeq_epi8(_mm_and_si128(x, bitMask), bitMask);
+    return _mm_sub_epi8(_mm_set1_epi8('0'), isSet);
+}
+
+static void writeBinSse2(char *dst, uint64_t value, size_t numBits)
+{
+    if (numBits == 8) {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), binCharsSse2(value & 0xff, 0));
+        return;
+    }
+    // 16 bits (16 characters) per step, most significant first.
+    for (size_t done = 0; done < numBits; done += 16) {
+        uint32_t chunk = static_cast<uint32_t>(value >> (numBits - 16 - done)) & 0xffff;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + done), binCharsSse2(chunk >> 8, chunk & 0xff));
+    }
+}
+
+static void encodeHexSse2(char *dst, const char *src, size_t numBytes)
+{
+    // 16 bytes into 32 digits per step. Same nibble split and digit conversion as writeHexSse2(), with the high and
+    // low halves of the interleave stored one after the other.
+    const __m128i lowMask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i letterOffset = _mm_set1_epi8('a' - '0' - 10);
+    const __m128i zeroChar = _mm_set1_epi8('0');
+    auto toDigits = [&](__m128i nibbles) {
+        __m128i letterFix = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), letterOffset);
+        return _mm_add_epi8(_mm_add_epi8(nibbles, zeroChar), letterFix);
+    };
+    size_t i = 0;
+    for (; i + 16 <= numBytes; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i hiNibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask);
+        __m128i loNibbles = _mm_and_si128(bytes, lowMask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), toDigits(_mm_unpacklo_epi8(hiNibbles, loNibbles)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2 + 16),
+                         toDigits(_mm_unpackhi_epi8(hiNibbles, loNibbles)));
+    }
+    encodeHexScalar(dst + i * 2, src + i, numBytes - i);
+}
+
+__attribute__((target("avx2")))
+static void encodeHexAvx2(char *dst, const char *src, size_t numBytes)
+{
+    // 32 bytes into 64 digits per step. The digits come from a 16 entry shuffle table. The interleave works within
+    // each 128 bit half, so the halves are put back in order with a cross lane permute before storing.
+    const __m256i digitTable = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+                                                'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+                                                'c', 'd', 'e', 'f');
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= numBytes; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i hiDigits = _mm256_shuffle_epi8(digitTable, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), lowMask));
+        __m256i loDigits = _mm256_shuffle_epi8(digitTable, _mm256_and_si256(bytes, lowMask));
+        __m256i first = _mm256_unpacklo_epi8(hiDigits, loDigits);   // bytes 0-7 and 16-23
+        __m256i second = _mm256_unpackhi_epi8(hiDigits, loDigits);  // bytes 8-15 and 24-31
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 2), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 2 + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    encodeHexSse2(dst + i * 2, src + i, numBytes - i);
+}
+
+// The value (0..15) of each hex digit character in x, and in valid the lanes that held a hex digit. Anything from 0x80
+// up is negative in the signed compares, so it is never taken for a digit.
+static inline __m128i hexDigitValuesSse2(__m128i x, __m128i &valid)
+{
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('0' - 1)),
+                                    _mm_cmplt_epi8(x, _mm_set1_epi8('9' + 1)));
+    __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));  // 'A'..'F' to 'a'..'f'
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    valid = _mm_or_si128(isDigit, isLetter);
+    __m128i digitValues = _mm_and_si128(isDigit, _mm_sub_epi8(x, _mm_set1_epi8('0')));
+    __m128i letterValues = _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)));
+    return _mm_or_si128(digitValues, letterValues);
+}
+
+// Joins the nibble pairs of 16 digit values (high nibble first in memory) into 8 bytes, one in each 16 bit lane.
+static inline __m128i joinNibblesSse2(__m128i nibbles)
+{
+    __m128i hi = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4);
+    return _mm_or_si128(hi, _mm_srli_epi16(nibbles, 8));
+}
+
+static bool decodeHexSse2(char *dst, const char *src, size_t numBytes)
+{
+    // 32 digits into 16 bytes per step. The printable mapping is the same as the table: bytes up to 0x1f (an unsigned
+    // compare, done as min) are replaced with a space.
+    __m128i allValid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 16 <= numBytes; i += 16) {
+        __m128i validLo;
+        __m128i validHi;
+        __m128i lo = hexDigitValuesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2)), validLo);
+        __m128i hi = hexDigitValuesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 16)), validHi);
+        allValid = _mm_and_si128(allValid, _mm_and_si128(validLo, validHi));
+        __m128i bytes = _mm_packus_epi16(joinNibblesSse2(lo), joinNibblesSse2(hi));
+        __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1f)), bytes);
+        bytes = _mm_or_si128(_mm_andnot_si128(isControl, bytes), _mm_and_si128(isControl, _mm_set1_epi8(' ')));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), bytes);
+    }
+    bool tailValid = decodeHexScalar(dst + i, src + i * 2, numBytes - i);
+    return tailValid && _mm_movemask_epi8(allValid) == 0xffff;
+}
+
+// A bit per character of x: set for white space. '\t' to '\r' are found with one unsigned compare, as the characters
+// from '\t' on that are at most 4 above it.
+static inline unsigned int spaceMaskSse2(__m128i x)
+{
+    __m128i fromTab = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+    __m128i isCtrl = _mm_cmpeq_epi8(_mm_min_epu8(fromTab, _mm_set1_epi8('\r' - '\t')), fromTab);
+    __m128i isBlank = _mm_cmpeq_epi8(x, _mm_set1_epi8(' '));
+    return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(isCtrl, isBlank)));
+}
+
+static size_t scanSpaceSse2(const char *src, size_t n, bool wantSpace)
+{
+    // 16 characters per step. The mask is flipped when looking for the end of the white space instead.
+    const unsigned int flip = (wantSpace) ? 0 : 0xffff;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned int mask = spaceMaskSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))) ^ flip;
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scanSpaceScalar(src + i, n - i, wantSpace);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hexDigitValuesAvx2(__m256i x, __m256i &valid)
+{
+    // Same as the SSE2 version
+    __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('0' - 1)),
+                                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), x));
+    __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+    __m256i isLetter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+    valid = _mm256_or_si256(isDigit, isLetter);
+    __m256i digitValues = _mm256_and_si256(isDigit, _mm256_sub_epi8(x, _mm256_set1_epi8('0')));
+    __m256i letterValues = _mm256_and_si256(isLetter, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10)));
+    return _mm256_or_si256(digitValues, letterValues);
+}
+
+__attribute__((target("avx2")))
+static bool decodeHexAvx2(char *dst, const char *src, size_t numBytes)
+{
+    // 64 digits into 32 bytes per step. Each nibble pair is joined with one multiply-add (high * 16 + low). The pack
+    // works within each 128 bit half, so a permute puts the 4 groups of 8 bytes back in order.
+    const __m256i nibbleWeights = _mm256_set1_epi16(0x0110);  // bytes 0x10, 0x01
+    __m256i allValid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= numBytes; i += 32) {
+        __m256i validLo;
+        __m256i validHi;
+        __m256i lo = hexDigitValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2)), validLo);
+        __m256i hi = hexDigitValuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2 + 32)),
+                                        validHi);
+        allValid = _mm256_and_si256(allValid, _mm256_and_si256(validLo, validHi));
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(lo, nibbleWeights),
+                                            _mm256_maddubs_epi16(hi, nibbleWeights));
+        bytes = _mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, _mm256_set1_epi8(0x1f)), bytes);
+        bytes = _mm256_blendv_epi8(bytes, _mm256_set1_epi8(' '), isControl);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), bytes);
+    }
+    bool tailValid = decodeHexSse2(dst + i, src + i * 2, numBytes - i);
+    return tailValid && _mm256_movemask_epi8(allValid) == -1;
+}
+
+__attribute__((target("avx2")))
+static size_t scanSpaceAvx2(const char *src, size_t n, bool wantSpace)
+{
+    // Same as the SSE2 version, 32 characters per step
+    const uint32_t flip = (wantSpace) ? 0 : 0xffffffff;
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i ctrlRange = _mm256_set1_epi8('\r' - '\t');
+    const __m256i blank = _mm256_set1_epi8(' ');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i fromTab = _mm256_sub_epi8(x, tab);
+        __m256i isSpace = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(fromTab, ctrlRange), fromTab),
+                                          _mm256_cmpeq_epi8(x, blank));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(isSpace)) ^ flip;
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scanSpaceSse2(src + i, n - i, wantSpace);
+}
+
+__attribute__((target("avx2")))
+static void writeBinAvx2(char *dst, uint64_t value, size_t numBits)
+{
+    if (numBits < 32) {
+        writeBinSse2(dst, value, numBits);
+        return;
+    }
+    // Broadcast 32 bits to every lane, then give each group of 8 output characters its own source byte, most
+    // significant byte first. The shuffle works within each 128-bit half, but every half holds a copy of all 4 bytes.
+    const __m256i byteSpread = _mm256_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+                                                1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i bitMask = _mm256_set1_epi64x(0x0102040810204080LL);
+    for (size_t done = 0; done < numBits; done += 32) {
+        uint32_t chunk = static_cast<uint32_t>(value >> (numBits - 32 - done));
+        __m256i x = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(chunk)), byteSpread);
+        __m256i isSet = _mm256_cmpeq_epi8(_mm256_and_si256(x, bitMask), bitMask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + done), _mm256_sub_epi8(_mm256_set1_epi8('0'), isSet));
+    }
+}
+
+// Reverses the bytes of every numBytes wide lane. SSE2 has no byte shuffle, so this swaps the two bytes of each 16 bit
+// lane, then the 16 bit halves of each 32 bit lane, then the 32 bit halves of each 64 bit lane, as far as needed.
+static inline __m128i byteSwapSse2(__m128i x, size_t numBytes)
+{
+    if (numBytes >= 2) {
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    }
+    if (numBytes >= 4) {
+        x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    }
+    if (numBytes == 8) {
+        x = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    }
+    return x;
+}
+
+// Zero extends the (little endian) numBytes wide lanes of x to 64 bits and stores them, 16 / numBytes values in all.
+// Each unpack with zero doubles the lane width, so it takes up to three rounds.
+static void widenStoreSse2(uint64_t *dst, __m128i x, size_t numBytes)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo;
+    __m128i hi;
+    switch (numBytes) {
+        case 1: {
+            lo = _mm_unpacklo_epi8(x, zero);
+            hi = _mm_unpackhi_epi8(x, zero);
+            break;
+        }
+        case 2: {
+            lo = _mm_unpacklo_epi16(x, zero);
+            hi = _mm_unpackhi_epi16(x, zero);
+            break;
+        }
+        case 4: {
+            lo = _mm_unpacklo_epi32(x, zero);
+            hi = _mm_unpackhi_epi32(x, zero);
+            break;
+        }
+        default: {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), x);
+            return;
+        }
+    }
+    widenStoreSse2(dst, lo, numBytes * 2);
+    widenStoreSse2(dst + 8 / numBytes, hi, numBytes * 2);
+}
+
+static void loadRecordsSse2(uint64_t *dst, const char *src, size_t count, size_t numBytes, bool bigEndian)
+{
+    // 16 bytes of records at a time. x86 is little endian, so only big endian records need their bytes swapped.
+    const size_t perVector = 16 / numBytes;
+    size_t i = 0;
+    for (; i + perVector <= count; i += perVector) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * numBytes));
+        if (bigEndian) {
+            x = byteSwapSse2(x, numBytes);
+        }
+        widenStoreSse2(dst + i, x, numBytes);
+    }
+    loadRecordsScalar(dst + i, src + i * numBytes, count - i, numBytes, bigEndian);
+}
+
+__attribute__((target("avx2")))
+static void loadRecordsAvx2(uint64_t *dst, const char *src, size_t count, size_t numBytes, bool bigEndian)
+{
+    // The byte swap is a single shuffle, and the zero extension to 64 bits is a single instruction per 4 values.
+    const __m128i swapMasks[] = {
+        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),   // 1 byte, nothing to swap
+        _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14),   // 2 bytes
+        _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12),   // 4 bytes
+        _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8)};  // 8 bytes
+    const __m128i swapMask = swapMasks[(numBytes == 8) ? 3 : numBytes / 2];
+    const size_t perVector = 16 / numBytes;
+    size_t i = 0;
+    for (; i + perVector <= count; i += perVector) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * numBytes));
+        if (bigEndian) {
+            x = _mm_shuffle_epi8(x, swapMask);
+        }
+        __m256i *out = reinterpret_cast<__m256i *>(dst + i);
+        switch (numBytes) {
+            case 1: {
+                _mm256_storeu_si256(out, _mm256_cvtepu8_epi64(x));
+                _mm256_storeu_si256(out + 1, _mm256_cvtepu8_epi64(_mm_srli_si128(x, 4)));
+                _mm256_storeu_si256(out + 2, _mm256_cvtepu8_epi64(_mm_srli_si128(x, 8)));
+                _mm256_storeu_si256(out + 3, _mm256_cvtepu8_epi64(_mm_srli_si128(x, 12)));
+                break;
+            }
+            case 2: {
+                _mm256_storeu_si256(out, _mm256_cvtepu16_epi64(x));
+                _mm256_storeu_si256(out + 1, _mm256_cvtepu16_epi64(_mm_srli_si128(x, 8)));
+                break;
+            }
+            case 4: {
+                _mm256_storeu_si256(out, _mm256_cvtepu32_epi64(x));
+                break;
+            }
+            default: {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), x);
+                break;
+            }
+        }
+    }
+    loadRecordsScalar(dst + i, src + i * numBytes, count - i, numBytes, bigEndian);
+}
+#endif
+
+const FmtKernels::Dispatch &FmtKernels::getDispatch()
+{
+    // Chosen once, on first use. FMTTOOL_KERNELS=scalar|sse2 can force a lesser kernel set, which is handy for
+    // checking that all of them produce the same output.
+    static const Dispatch dispatch = []() {
+        const char *forced = std::getenv("FMTTOOL_KERNELS");
+        std::string want = (forced != nullptr) ? forced : "";
+#if defined(__x86_64__)
+        if (want != "scalar") {
+            if (want != "sse2" && __builtin_cpu_supports("avx2")) {
+                return Dispatch{writeHexSse2, writeBinAvx2, loadRecordsAvx2, encodeHexAvx2, decodeHexAvx2,
+                                scanSpaceAvx2, "avx2"};
+            }
+            return Dispatch{writeHexSse2, writeBinSse2, loadRecordsSse2, encodeHexSse2, decodeHexSse2, scanSpaceSse2,
+                            "sse2"};
+        }
+#endif
+        return Dispatch{writeHexScalar, writeBinScalar, loadRecordsScalar, encodeHexScalar, decodeHexScalar,
+                        scanSpaceScalar, "scalar"};
+    }();
+    return dispatch;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Low level rendering kernels for the integer columns, the hex encoder and decoder of the ascii and binary types, the
+// loader for binary records and the white space scan of the input tokenizer. These write straight into a destination
+// buffer that the caller has already sized, so there are no temporary strings or streams involved.
+// On x86 there are SSE2 and AVX2 versions of the kernels. The best one for the running cpu is picked the first time
+// a kernel is used. Everything else gets the plain scalar version.
+class FmtKernels {
+public:
+    // Writes numBytes * 2 lower case hex digits of the low numBytes bytes of value, most significant digit first.
+    // No "0x" prefix is written. numBytes must be 1 to 8.
+    static void writeHex(char *dst, uint64_t value, size_t numBytes)
+    {
+        getDispatch().hexFn(dst, value, numBytes);
+    }
+
+    // Writes numBits '0'/'1' characters of the low numBits bits of value, most significant bit first.
+    // numBits must be 8, 16, 32 or 64.
+    static void writeBin(char *dst, uint64_t value, size_t numBits)
+    {
+        getDispatch().binFn(dst, value, numBits);
+    }
+
+    // Reads count fixed size binary records of numBytes (1, 2, 4 or 8) each from src, zero extended to 64 bits.
+    // The records are little endian unless bigEndian is set. Used by the -raw input.
+    static void loadRecords(uint64_t *dst, const char *src, size_t count, size_t numBytes, bool bigEndian)
+    {
+        getDispatch().recordFn(dst, src, count, numBytes, bigEndian);
+    }
+
+    // Writes each of the numBytes bytes at src as 2 lower case hex digits, 2 * numBytes characters in all, in the same
+    // order. No "0x" prefix is written. There is no length limit.
+    static void encodeHex(char *dst, const char *src, size_t numBytes)
+    {
+        getDispatch().encodeHexFn(dst, src, numBytes);
+    }
+
+    // Decodes numBytes bytes from the 2 * numBytes hex digits at src (upper or lower case, no "0x"), and writes each
+    // one to dst as a printable character: a byte below 0x20 becomes a space, every other byte is written as is.
+    // Returns false if any of the characters is not a hex digit, in which case what was written to dst is garbage.
+    // There is no length limit. The input is worked through in vector sized chunks.
+    static bool decodeHex(char *dst, const char *src, size_t numBytes)
+    {
+        return getDispatch().decodeHexFn(dst, src, numBytes);
+    }
+
+    // The index of the first white space character in the n characters at src, or n if there is none. White space is
+    // the same set that std::isspace has in the C locale: ' ' and '\t' to '\r'.
+    static size_t findSpace(const char *src, size_t n)
+    {
+        return getDispatch().scanSpaceFn(src, n, true);
+    }
+
+    // The index of the first character at src that is not white space, or n if they all are.
+    static size_t skipSpace(const char *src, size_t n)
+    {
+        return getDispatch().scanSpaceFn(src, n, false);
+    }
+
+    // Name of the kernel set that was chosen for this cpu (for diagnostics).
+    static const char *getKernelName()
+    {
+        return getDispatch().name;
+    }
+
+private:
+    using HexFn = void (*)(char *dst, uint64_t value, size_t numBytes);
+    using BinFn = void (*)(char *dst, uint64_t value, size_t numBits);
+    using RecordFn = void (*)(uint64_t *dst, const char *src, size_t count, size_t numBytes, bool bigEndian);
+    using EncodeHexFn = void (*)(char *dst, const char *src, size_t numBytes);
+    using DecodeHexFn = bool (*)(char *dst, const char *src, size_t numBytes);
+    using ScanSpaceFn = size_t (*)(const char *src, size_t n, bool wantSpace);
+
+    struct Dispatch {
+        HexFn hexFn;
+        BinFn binFn;
+        RecordFn recordFn;
+        EncodeHexFn encodeHexFn;
+        DecodeHexFn decodeHexFn;
+        ScanSpaceFn scanSpaceFn;
+        const char *name;
+    };
+
+    static const Dispatch &getDispatch();
+};
@@ -0,0 +1,153 @@
+#include "fmt_pipeline.h"
+#include <utility>
+#include "fmt_exception.h"
+
+FmtPipeline::FmtPipeline(size_t numWorkers, ReadFn readFn, FormatFn formatFn, WriteFn writeFn, IdleFn idleFn)
+    : numWorkers_(numWorkers), maxInFlight_(numWorkers * 4), readFn_(std::move(readFn)),
+      formatFn_(std::move(formatFn)), writeFn_(std::move(writeFn)), idleFn_(std::move(idleFn)), slots_(maxInFlight_),
+      nextRead_(0), nextFormat_(0), nextWrite_(0), readDone_(false), aborted_(false), error_(nullptr)
+{
+    if (numWorkers_ == 0) {
+        THROW_FMT_EXCEPTION("The formatting pipeline needs at least one worker.");
+    }
+}
+
+void FmtPipeline::run()
+{
+    std::vector<std::thread> threads;
+    threads.emplace_back(&FmtPipeline::readerLoop, this);
+    for (size_t i = 0; i < numWorkers_; ++i) {
+        threads.emplace_back(&FmtPipeline::workerLoop, this, i);
+    }
+
+    // The writer runs right here on the calling thread.
+    try {
+        writerLoop();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void FmtPipeline::fail(std::exception_ptr err)
+{
+    // Only the first error is kept. Everybody is woken up so they can see the abort and exit.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+            error_ = err;
+        }
+        aborted_ = true;
+    }
+    readerCv_.notify_all();
+    workerCv_.notify_all();
+    writerCv_.notify_all();
+}
+
+void FmtPipeline::readerLoop()
+{
+    try {
+        bool moreData = true;
+        while (moreData) {
+            // Wait for a free slot. A slot is free once the writer has output the batch that used it last.
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                readerCv_.wait(lock, [this]() { return aborted_ || nextRead_ - nextWrite_ < maxInFlight_; });
+                if (aborted_) {
+                    return;
+                }
+            }
+
+            // Nobody else looks at this slot until it is published below, so it can be filled without the lock.
+            // The batch buffers are reused from the last time around to save on allocations.
+            Batch &batch = slots_[nextRead_ % maxInFlight_];
+            moreData = readFn_(batch.input);
+            size_t count = batch.input.values.size();
+            batch.formatted = false;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (count > 0) {
+                    ++nextRead_;
+                }
+                if (!moreData) {
+                    readDone_ = true;
+                }
+            }
+            workerCv_.notify_all();
+            writerCv_.notify_one();
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+void FmtPipeline::workerLoop(size_t worker)
+{
+    while (true) {
+        size_t seq;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workerCv_.wait(lock, [this]() { return aborted_ || nextFormat_ < nextRead_ || readDone_; });
+            if (aborted_ || nextFormat_ == nextRead_) {
+                return;  // aborted, or the reader is done and there is nothing left to take
+            }
+            seq = nextFormat_++;
+        }
+
+        Batch &batch = slots_[seq % maxInFlight_];
+        try {
+            formatFn_(worker, batch.input, batch.cols);
+        } catch (...) {
+            fail(std::current_exception());
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch.formatted = true;
+        }
+        writerCv_.notify_one();
+    }
+}
+
+void FmtPipeline::writerLoop()
+{
+    while (true) {
+        Batch *batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto canProceed = [this]() {
+                return aborted_ || (nextWrite_ < nextRead_ && slots_[nextWrite_ % maxInFlight_].formatted) ||
+                       (readDone_ && nextWrite_ == nextRead_);
+            };
+            if (!canProceed()) {
+                // Let the caller flush whatever it has written before we go to sleep.
+                lock.unlock();
+                idleFn_();
+                lock.lock();
+                writerCv_.wait(lock, canProceed);
+            }
+            if (aborted_ || nextWrite_ == nextRead_) {
+                return;
+            }
+            batch = &slots_[nextWrite_ % maxInFlight_];
+        }
+
+        // Batches only complete in seq order from here, so the input order is kept.
+        writeFn_(batch->cols);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch->formatted = false;
+            ++nextWrite_;
+        }
+        readerCv_.notify_one();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "fmt_column.h"
+#include "fmt_type.h"
+
+// A three stage pipeline for formatting large inputs on several threads:
+// 1) A reader thread pulls batches of values from the input.
+// 2) A pool of worker threads formats the batches. Each value is independent, so any worker can take any batch.
+// 3) The writer stage runs on the calling thread and hands the formatted rows back out in the original input order.
+// The number of batches that are read but not yet written is bounded, so memory stays flat no matter how much input
+// there is.
+class FmtPipeline {
+public:
+    using ColumnList = std::vector<FmtColumnData>;
+
+    // One batch of input values. The buffers belong to the batch and are reused from one batch to the next.
+    struct InputBatch {
+        std::vector<char> text;                // backing text of values read from stdin (see InputTokenizer)
+        std::vector<std::string_view> values;
+        std::vector<uint64_t> rawValues;       // -raw input only: the records as numbers, one per value
+        std::string rawText;                   // -raw input only: backing text of the values
+    };
+
+    // Fills the batch with the next values of the input. Returns false at the end of the input, in which case the
+    // batch holds whatever was left (maybe nothing). A value may point into the batch, or anywhere else that stays
+    // valid until the pipeline finishes.
+    using ReadFn = std::function<bool(InputBatch &input)>;
+    // worker is the index (0 to numWorkers - 1) of the worker thread making the call, for per thread state.
+    using FormatFn = std::function<void(size_t worker, const InputBatch &input, ColumnList &cols)>;
+    using WriteFn = std::function<void(const ColumnList &cols)>;
+    using IdleFn = std::function<void()>;                    // writer is about to wait for more rows
+
+    FmtPipeline(size_t numWorkers, ReadFn readFn, FormatFn formatFn, WriteFn writeFn, IdleFn idleFn);
+    ~FmtPipeline() = default;
+
+    // Runs all three stages until the input is exhausted. An exception thrown by any stage stops the pipeline and is
+    // re-thrown here.
+    void run();
+
+private:
+    struct Batch {
+        InputBatch input;
+        ColumnList cols;                      // formatted output, one FmtColumnData per output column
+        bool formatted = false;
+    };
+
+    void readerLoop();
+    void workerLoop(size_t worker);
+    void writerLoop();
+    void fail(std::exception_ptr err);
+
+    size_t numWorkers_;
+    size_t maxInFlight_;         // batches read but not yet written
+    ReadFn readFn_;
+    FormatFn formatFn_;
+    WriteFn writeFn_;
+    IdleFn idleFn_;
+
+    std::mutex mutex_;
+    std::condition_variable readerCv_;  // a slot freed up
+    std::condition_variable workerCv_;  // a batch is ready to format
+    std::condition_variable writerCv_;  // a batch finished formatting
+    std::vector<Batch> slots_;          // ring of in flight batches, indexed by seq % maxInFlight_
+    size_t nextRead_;                   // seq of the next batch the reader will fill
+    size_t nextFormat_;                 // seq of the next batch a worker will take
+    size_t nextWrite_;                  // seq of the next batch the writer will output
+    bool readDone_;
+    bool aborted_;
+    std::exception_ptr error_;
+};
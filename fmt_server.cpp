@@ -0,0 +1,327 @@
+#include "fmt_server.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "fmt_exception.h"
+#include "input_tokenizer.h"
+
+const size_t FmtServer::MAX_FRAME_SIZE = 16 * 1024 * 1024;      // biggest request payload we accept
+const size_t FmtServer::MAX_PENDING_OUTPUT = 4 * 1024 * 1024;   // stop taking requests from a client that isn't reading
+const size_t FmtServer::MAX_RESPONSE_SIZE = 64 * 1024 * 1024;   // biggest response payload we send
+
+static const size_t FRAME_HEADER_SIZE = 4;
+static const size_t READ_CHUNK = 64 * 1024;
+static const size_t BATCH_SIZE = 4096;  // values of a request formatted together
+static const int MAX_EVENTS = 64;
+
+FmtServer::FmtServer(const std::string &socketPath, const FmtFormatter &formatter)
+    : socketPath_(socketPath), formatter_(formatter), listenFd_(-1), epollFd_(-1), signalFd_(-1)
+{
+    sigemptyset(&oldSigMask_);
+    try {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socketPath_.empty() || socketPath_.size() >= sizeof(addr.sun_path)) {
+            THROW_FMT_EXCEPTION("Invalid socket path for -serve: " + socketPath_);
+        }
+        std::memcpy(addr.sun_path, socketPath_.c_str(), socketPath_.size());
+
+        // A socket file left behind by a server that didn't exit cleanly would make bind fail. Anything else at that
+        // path is left alone.
+        struct stat pathStat;
+        if (lstat(socketPath_.c_str(), &pathStat) == 0 && S_ISSOCK(pathStat.st_mode)) {
+            unlink(socketPath_.c_str());
+        }
+
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0) {
+            THROW_FMT_EXCEPTION(std::string("Unable to create the server socket: ") + std::strerror(errno));
+        }
+        if (bind(listenFd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            std::string errMsg = std::strerror(errno);
+            close(listenFd_);
+            listenFd_ = -1;  // we don't own the path, so it must not be unlinked on the way out
+            THROW_FMT_EXCEPTION("Unable to bind the server socket " + socketPath_ + ": " + errMsg);
+        }
+        if (listen(listenFd_, SOMAXCONN) != 0) {
+            THROW_FMT_EXCEPTION(std::string("Unable to listen on the server socket: ") + std::strerror(errno));
+        }
+
+        // The stop signals are taken as events of the loop rather than by a handler, so a stop never lands in the
+        // middle of a request.
+        sigset_t stopSignals;
+        sigemptyset(&stopSignals);
+        sigaddset(&stopSignals, SIGINT);
+        sigaddset(&stopSignals, SIGTERM);
+        sigprocmask(SIG_BLOCK, &stopSignals, &oldSigMask_);
+        signalFd_ = signalfd(-1, &stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (signalFd_ < 0) {
+            THROW_FMT_EXCEPTION(std::string("Unable to create the signal fd: ") + std::strerror(errno));
+        }
+
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ < 0) {
+            THROW_FMT_EXCEPTION(std::string("Unable to create the epoll fd: ") + std::strerror(errno));
+        }
+        for (int fd : {listenFd_, signalFd_}) {
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+                THROW_FMT_EXCEPTION(std::string("Unable to add to the epoll fd: ") + std::strerror(errno));
+            }
+        }
+    } catch (...) {
+        cleanup();
+        throw;
+    }
+}
+
+FmtServer::~FmtServer()
+{
+    cleanup();
+}
+
+void FmtServer::cleanup()
+{
+    for (auto &client : clients_) {
+        close(client.first);
+    }
+    clients_.clear();
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        listenFd_ = -1;
+        unlink(socketPath_.c_str());
+    }
+    if (signalFd_ >= 0) {
+        close(signalFd_);
+        signalFd_ = -1;
+        sigprocmask(SIG_SETMASK, &oldSigMask_, nullptr);
+    }
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+        epollFd_ = -1;
+    }
+}
+
+void FmtServer::run()
+{
+    epoll_event events[MAX_EVENTS];
+    while (true) {
+        int numEvents = epoll_wait(epollFd_, events, MAX_EVENTS, -1);
+        if (numEvents < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            THROW_FMT_EXCEPTION(std::string("epoll_wait failed: ") + std::strerror(errno));
+        }
+        for (int i = 0; i < numEvents; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == signalFd_) {
+                return;  // asked to stop
+            }
+            if (fd == listenFd_) {
+                acceptClients();
+                continue;
+            }
+            auto clientIter = clients_.find(fd);
+            if (clientIter == clients_.end()) {
+                continue;  // closed earlier in this same round of events
+            }
+
+            // Read what has arrived, answer every complete request, and send as much of the answers as the socket
+            // takes. Whatever doesn't fit waits for EPOLLOUT.
+            Connection &conn = clientIter->second;
+            uint32_t ready = events[i].events;
+            bool keepOpen = !(ready & EPOLLERR);
+            if (keepOpen && (ready & (EPOLLIN | EPOLLHUP))) {
+                keepOpen = readFromClient(fd, conn);
+            }
+            keepOpen = keepOpen && handleRequests(conn) && writeToClient(fd, conn);
+            if (keepOpen && conn.peerClosed && conn.outPos == conn.outBuf.size()) {
+                keepOpen = false;  // the client is gone and has its last answer
+            }
+            if (keepOpen) {
+                updateEvents(fd, conn);
+            } else {
+                closeClient(fd);
+            }
+        }
+    }
+}
+
+void FmtServer::acceptClients()
+{
+    while (true) {
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // EAGAIN means we have them all. Anything else (a client that gave up, out of fds) only costs that one
+            // client, so the server carries on.
+            return;
+        }
+        Connection &conn = clients_[fd];
+        conn.events = EPOLLIN;
+        epoll_event event;
+        event.events = conn.events;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            closeClient(fd);
+        }
+    }
+}
+
+bool FmtServer::readFromClient(int fd, Connection &conn)
+{
+    // One read per wake up. The epoll is level triggered, so if there is more we are woken again, and a busy client
+    // can't hold up the others.
+    size_t used = conn.inBuf.size();
+    conn.inBuf.resize(used + READ_CHUNK);
+    ssize_t numRead;
+    do {
+        numRead = recv(fd, conn.inBuf.data() + used, READ_CHUNK, 0);
+    } while (numRead < 0 && errno == EINTR);
+    conn.inBuf.resize(used + std::max<ssize_t>(numRead, 0));
+
+    if (numRead == 0) {
+        conn.peerClosed = true;
+    } else if (numRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+    }
+    return true;
+}
+
+bool FmtServer::handleRequests(Connection &conn)
+{
+    // Answer every complete frame in the input, in order. Returns false if the client broke the protocol.
+    size_t pos = 0;
+    while (conn.outBuf.size() - conn.outPos < MAX_PENDING_OUTPUT) {
+        if (conn.inBuf.size() - pos < FRAME_HEADER_SIZE) {
+            break;
+        }
+        const unsigned char *header = reinterpret_cast<const unsigned char *>(conn.inBuf.data() + pos);
+        size_t frameSize = (size_t(header[0]) << 24) | (size_t(header[1]) << 16) | (size_t(header[2]) << 8) |
+                           size_t(header[3]);
+        if (frameSize > MAX_FRAME_SIZE) {
+            return false;
+        }
+        if (conn.inBuf.size() - pos - FRAME_HEADER_SIZE < frameSize) {
+            break;  // the rest of this frame hasn't arrived yet
+        }
+        if (!formatRequest(std::string_view(conn.inBuf.data() + pos + FRAME_HEADER_SIZE, frameSize), conn.outBuf)) {
+            return false;
+        }
+        pos += FRAME_HEADER_SIZE + frameSize;
+    }
+    conn.inBuf.erase(conn.inBuf.begin(), conn.inBuf.begin() + pos);
+
+    // A client that closed its end with half a frame left can never complete it.
+    return !(conn.peerClosed && !conn.inBuf.empty() && conn.outBuf.size() - conn.outPos < MAX_PENDING_OUTPUT);
+}
+
+bool FmtServer::formatRequest(std::string_view payload, std::vector<char> &out)
+{
+    // Split the values the same way the -f tokenizer does, then format them in batches. Returns false, with nothing
+    // added to out, if the response would be too big to send.
+    values_.clear();
+    InputTokenizer::split(payload, InputTokenizer::Mode::TOKENS, values_);
+
+    if (cols_.size() != formatter_.getColumnCount()) {
+        cols_.clear();
+        cols_.resize(formatter_.getColumnCount());
+    }
+
+    // The response frame. Its length goes in front once the body is written. The body has to fit the 4 byte length,
+    // and the request is only started while the client has less than MAX_PENDING_OUTPUT waiting. The values are
+    // formatted a batch at a time and the size is checked as the rows go in, so a response that runs past
+    // MAX_RESPONSE_SIZE is dropped before it can use much more memory than that.
+    static_assert(sizeof(uint32_t) == FRAME_HEADER_SIZE, "the frame length is a uint32_t");
+    const size_t maxBodySize = std::min<size_t>(MAX_RESPONSE_SIZE, UINT32_MAX);
+    size_t headerPos = out.size();
+    out.resize(headerPos + FRAME_HEADER_SIZE);
+    for (size_t first = 0; first < values_.size(); first += BATCH_SIZE) {
+        size_t count = std::min(BATCH_SIZE, values_.size() - first);
+        for (auto &col : cols_) {
+            col.clear();
+        }
+        formatter_.formatBatch(values_.data() + first, count, cols_.data());
+        for (size_t row = 0; row < count; ++row) {
+            for (size_t col = 0; col < cols_.size(); ++col) {
+                if (col > 0) {
+                    out.push_back('\t');
+                }
+                std::string_view cell = cols_[col].getCell(row);
+                out.insert(out.end(), cell.begin(), cell.end());
+            }
+            out.push_back('\n');
+        }
+        if (out.size() - headerPos - FRAME_HEADER_SIZE > maxBodySize) {
+            out.resize(headerPos);
+            return false;
+        }
+    }
+    size_t bodySize = out.size() - headerPos - FRAME_HEADER_SIZE;
+    out[headerPos] = static_cast<char>((bodySize >> 24) & 0xff);
+    out[headerPos + 1] = static_cast<char>((bodySize >> 16) & 0xff);
+    out[headerPos + 2] = static_cast<char>((bodySize >> 8) & 0xff);
+    out[headerPos + 3] = static_cast<char>(bodySize & 0xff);
+    return true;
+}
+
+bool FmtServer::writeToClient(int fd, Connection &conn)
+{
+    while (conn.outPos < conn.outBuf.size()) {
+        ssize_t numWritten = send(fd, conn.outBuf.data() + conn.outPos, conn.outBuf.size() - conn.outPos,
+                                  MSG_NOSIGNAL);
+        if (numWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;  // the rest goes when the socket has room
+            }
+            return false;
+        }
+        conn.outPos += static_cast<size_t>(numWritten);
+    }
+    conn.outBuf.clear();  // all sent. The capacity is kept for the next answers.
+    conn.outPos = 0;
+    return true;
+}
+
+void FmtServer::updateEvents(int fd, Connection &conn)
+{
+    // Wait for room to write while there are unsent answers. Stop reading from a client whose answers are piling up
+    // until it reads them, or from one that has closed its end.
+    size_t pending = conn.outBuf.size() - conn.outPos;
+    uint32_t events = 0;
+    if (pending < MAX_PENDING_OUTPUT && !conn.peerClosed) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != conn.events) {
+        epoll_event event;
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event);
+        conn.events = events;
+    }
+}
+
+void FmtServer::closeClient(int fd)
+{
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients_.erase(fd);
+}
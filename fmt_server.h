@@ -0,0 +1,70 @@
+#pragma once
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "fmt_column.h"
+#include "fmt_formatter.h"
+
+// The -serve mode: a long running process that formats values for clients over a Unix domain socket, so the format
+// types are set up once instead of once per fmttool run.
+//
+// The protocol is a stream of frames in both directions. A frame is a 4 byte length (big endian, not counting the
+// length itself) followed by that many bytes of payload.
+//  - Request payload: the user values, separated by white space, the same as they would be given to fmttool.
+//  - Response payload: one line per value, in order. Each line is the formatter's output columns separated by tabs,
+//    ending with a newline. (The input column is not repeated.)
+// A client may send any number of requests without waiting. The responses come back in the same order, one for each
+// request. A frame larger than MAX_FRAME_SIZE closes the connection, and so does a request whose response would be
+// larger than MAX_RESPONSE_SIZE (the response is not sent).
+//
+// All of the clients are served from one thread by an epoll event loop. SIGINT or SIGTERM stop the server, and it
+// removes its socket file on the way out.
+class FmtServer {
+public:
+    static const size_t MAX_FRAME_SIZE;
+    static const size_t MAX_PENDING_OUTPUT;
+    static const size_t MAX_RESPONSE_SIZE;
+
+    FmtServer(const std::string &socketPath, const FmtFormatter &formatter);
+    ~FmtServer();
+    FmtServer(const FmtServer &) = delete;
+    FmtServer &operator=(const FmtServer &) = delete;
+
+    // Serves clients until a stop signal arrives.
+    void run();
+
+private:
+    struct Connection {
+        std::vector<char> inBuf;   // received bytes not yet handled (partial frames)
+        std::vector<char> outBuf;  // response bytes not yet sent
+        size_t outPos = 0;         // how much of outBuf is already sent
+        uint32_t events = 0;       // the epoll events we are registered for
+        bool peerClosed = false;   // the client shut down its end. Finish its requests, then close.
+    };
+
+    void acceptClients();
+    void cleanup();
+    bool readFromClient(int fd, Connection &conn);
+    bool handleRequests(Connection &conn);
+    bool formatRequest(std::string_view payload, std::vector<char> &out);
+    bool writeToClient(int fd, Connection &conn);
+    void updateEvents(int fd, Connection &conn);
+    void closeClient(int fd);
+
+    std::string socketPath_;
+    const FmtFormatter &formatter_;
+    int listenFd_;
+    int epollFd_;
+    int signalFd_;
+    sigset_t oldSigMask_;
+    std::unordered_map<int, Connection> clients_;
+
+    // Reused for every request, so that a steady stream of requests doesn't allocate.
+    std::vector<std::string_view> values_;
+    std::vector<FmtColumnData> cols_;
+};
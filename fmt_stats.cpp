@@ -0,0 +1,112 @@
+#include "fmt_stats.h"
+#include <cstdio>
+#include "alloc_counter.h"
+#include <sys/resource.h>
+
+void LogHistogram::merge(const LogHistogram &other)
+{
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+}
+
+std::string LogHistogram::toString() const
+{
+    std::string text;
+    char line[96];
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        if (buckets_[i] == 0) {
+            continue;
+        }
+        uint64_t low = (i == 0) ? 0 : (uint64_t(1) << (i - 1));
+        uint64_t high = (i == 0) ? 1 : (i == 64) ? UINT64_MAX : (uint64_t(1) << i);
+        std::snprintf(line, sizeof(line), "    [%llu,%llu) %llu\n", static_cast<unsigned long long>(low),
+                      static_cast<unsigned long long>(high), static_cast<unsigned long long>(buckets_[i]));
+        text += line;
+    }
+    return text.empty() ? "    -\n" : text;
+}
+
+void FmtStats::initTypes(const std::vector<std::string> &typeNames)
+{
+    types_.clear();
+    types_.resize(typeNames.size());
+    for (size_t i = 0; i < typeNames.size(); ++i) {
+        types_[i].name = typeNames[i];
+    }
+}
+
+void FmtStats::merge(const FmtStats &other)
+{
+    for (size_t i = 0; i < static_cast<size_t>(Stage::NUM_STAGES); ++i) {
+        stageNs_[i] += other.stageNs_[i];
+    }
+    tokens_ += other.tokens_;
+    bytes_ += other.bytes_;
+    formatAllocs_ += other.formatAllocs_;
+    if (types_.size() < other.types_.size()) {
+        types_.resize(other.types_.size());
+    }
+    for (size_t i = 0; i < other.types_.size(); ++i) {
+        TypeStats &mine = types_[i];
+        const TypeStats &theirs = other.types_[i];
+        if (mine.name.empty()) {
+            mine.name = theirs.name;
+        }
+        mine.ns += theirs.ns;
+        mine.values += theirs.values;
+        mine.valid += theirs.valid;
+        mine.outOfRange += theirs.outOfRange;
+        mine.invalid += theirs.invalid;
+        mine.latency.merge(theirs.latency);
+    }
+}
+
+std::string FmtStats::toString(uint64_t wallNs) const
+{
+    static const char *STAGE_NAMES[] = {"read", "format", "store", "display"};
+    std::string text = "stats:\n";
+    char line[160];
+    double wallSecs = wallNs / 1e9;
+    std::snprintf(line, sizeof(line), "  wall time       %.6f s\n", wallSecs);
+    text += line;
+    std::snprintf(line, sizeof(line), "  tokens          %llu (%.0f /s)\n", static_cast<unsigned long long>(tokens_),
+                  (wallSecs > 0) ? tokens_ / wallSecs : 0.0);
+    text += line;
+    std::snprintf(line, sizeof(line), "  bytes           %llu (%.0f /s)\n", static_cast<unsigned long long>(bytes_),
+                  (wallSecs > 0) ? bytes_ / wallSecs : 0.0);
+    text += line;
+
+    // With -j the format stage runs on several threads at once, so its time is the sum over the threads.
+    for (size_t i = 0; i < static_cast<size_t>(Stage::NUM_STAGES); ++i) {
+        std::snprintf(line, sizeof(line), "  stage %-9s %.6f s\n", STAGE_NAMES[i], stageNs_[i] / 1e9);
+        text += line;
+    }
+
+    if (AllocCounter::isEnabled()) {
+        std::snprintf(line, sizeof(line), "  format allocs   %llu (%.4f per token)\n",
+                      static_cast<unsigned long long>(formatAllocs_),
+                      (tokens_ > 0) ? static_cast<double>(formatAllocs_) / tokens_ : 0.0);
+        text += line;
+    }
+
+    for (const auto &typeStats : types_) {
+        std::snprintf(line, sizeof(line),
+                      "  type %-10s %.6f s, %llu formatted, results: %llu valid, %llu out_of_range, %llu invalid\n",
+                      typeStats.name.c_str(), typeStats.ns / 1e9, static_cast<unsigned long long>(typeStats.values),
+                      static_cast<unsigned long long>(typeStats.valid),
+                      static_cast<unsigned long long>(typeStats.outOfRange),
+                      static_cast<unsigned long long>(typeStats.invalid));
+        text += line;
+        text += "   ns per value (one sample per batch):\n";
+        text += typeStats.latency.toString();
+    }
+
+    // ru_maxrss is in KB on Linux
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        std::snprintf(line, sizeof(line), "  peak rss        %ld KB\n", usage.ru_maxrss);
+        text += line;
+    }
+    return text;
+}
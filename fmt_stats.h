@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counts values into power of 2 buckets: bucket b holds the values in [2^(b-1), 2^b), and bucket 0 holds 0.
+class LogHistogram {
+public:
+    static const size_t NUM_BUCKETS = 65;
+
+    void add(uint64_t value)
+    {
+        ++buckets_[(value == 0) ? 0 : 64 - __builtin_clzll(value)];
+    }
+
+    void merge(const LogHistogram &other);
+
+    // One line of "[low,high) count" for each bucket in use, or "-" if there are none.
+    std::string toString() const;
+
+private:
+    uint64_t buckets_[NUM_BUCKETS] = {};
+};
+
+// The counters for -stats. Everything is counted per batch of values, never per value, so the cost is a few clock
+// reads for every few thousand values, and it can be left on. Each thread fills its own FmtStats, and they are
+// merged for the report. Aligned to a cache line so that per-thread counters kept side by side don't share one.
+class alignas(64) FmtStats {
+public:
+    enum class Stage : int8_t {
+        READ = 0,     // reading and tokenizing the input
+        FORMAT = 1,   // running the format types (or the cache)
+        STORE = 2,    // adding the rows to the result table, or writing them out as they come
+        DISPLAY = 3,  // writing the result table
+        NUM_STAGES = 4
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static uint64_t nsSince(Clock::time_point start)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        return static_cast<uint64_t>(elapsed.count());
+    }
+
+    // One entry per format type, in the formatter's order. Must be called before any addType...() calls.
+    void initTypes(const std::vector<std::string> &typeNames);
+
+    void addStage(Stage stage, uint64_t ns)
+    {
+        stageNs_[static_cast<size_t>(stage)] += ns;
+    }
+
+    // Calls to operator new made while formatting (see AllocCounter)
+    void addFormatAllocs(uint64_t allocs)
+    {
+        formatAllocs_ += allocs;
+    }
+
+    void addInput(uint64_t tokens, uint64_t bytes)
+    {
+        tokens_ += tokens;
+        bytes_ += bytes;
+    }
+
+    // One batch of count values through format type typeIdx, taking ns
+    void addTypeTime(size_t typeIdx, uint64_t ns, uint64_t count)
+    {
+        TypeStats &typeStats = types_[typeIdx];
+        typeStats.ns += ns;
+        typeStats.values += count;
+        if (count > 0) {
+            typeStats.latency.add(ns / count);
+        }
+    }
+
+    void addTypeResults(size_t typeIdx, uint64_t valid, uint64_t outOfRange, uint64_t invalid)
+    {
+        TypeStats &typeStats = types_[typeIdx];
+        typeStats.valid += valid;
+        typeStats.outOfRange += outOfRange;
+        typeStats.invalid += invalid;
+    }
+
+    void merge(const FmtStats &other);
+
+    // The full report, several lines. wallNs is the elapsed time of the whole run.
+    std::string toString(uint64_t wallNs) const;
+
+private:
+    struct TypeStats {
+        std::string name;
+        uint64_t ns = 0;
+        uint64_t values = 0;      // values formatted (cache hits are not formatted, so not counted here)
+        uint64_t valid = 0;       // results, cache hits included
+        uint64_t outOfRange = 0;
+        uint64_t invalid = 0;
+        LogHistogram latency;     // ns per value, one sample per batch
+    };
+
+    uint64_t stageNs_[static_cast<size_t>(Stage::NUM_STAGES)] = {};
+    uint64_t tokens_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t formatAllocs_ = 0;
+    std::vector<TypeStats> types_;
+};
@@ -1,16 +1,32 @@
 #include "fmt_tool.h"
-#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
-#include "ascii_type.h"
-#include "binary_type.h"
+#include <memory_resource>
+#include <poll.h>
+#include <unistd.h>
+#include "alloc_counter.h"
 #include "fmt_type.h"
 #include "fmt_exception.h"
-#include "int_type.h"
+#include "fmt_kernels.h"
+#include "fmt_pipeline.h"
+#include "fmt_server.h"
+#include "multi_file_runner.h"
 
 const std::string FmtTool::DFT_ARGS = "-i 32";
 const int FmtTool::COL_SPACE = 2;  // Provide 2 whitespaces in between each column
+const size_t FmtTool::BATCH_SIZE = 4096;  // values read and formatted together
+const size_t FmtTool::MAX_JOBS = 1024;    // -j past this is a typo, not a thread count
+const size_t FmtTool::MAX_CACHE_ENTRIES = 16 * 1024 * 1024;  // per thread. Gigabytes of cache past this
 
-FmtTool::FmtTool() : iSStream_(nullptr), inStream_(nullptr), helpRequested_(false)
+FmtTool::FmtTool(int outFd) : userPos_(0), lineMode_(false), mapPos_(0), rawBits_(0), rawBigEndian_(false),
+                              rawPos_(0), rawLen_(0), rawEof_(false), helpRequested_(false), cacheSize_(0),
+                              maxMem_(0), showStats_(false), numJobs_(1),
+                              stream_(false), out_(outFd)
 {
     // Populate the formatting type map argument options.
     // This is done so that we may do switch during argument parsing of the input args
@@ -19,10 +35,92 @@ FmtTool::FmtTool() : iSStream_(nullptr), inStream_(nullptr), helpRequested_(fals
     cmdArgMap_["-a"] = CmdArg::ASCII;         // Input is assumed to be a string
     cmdArgMap_["-b"] = CmdArg::BINARY;        // Input is assume to be an array of bytes in hex (prefixed with 0x..)
     cmdArgMap_["-nobin"] = CmdArg::SUPP_BIN;  // Supress binary ouput for integer types
+    cmdArgMap_["-stream"] = CmdArg::STREAM;   // Write rows as they are formatted rather than after all input is read
+    cmdArgMap_["-j"] = CmdArg::JOBS;          // Number of formatting threads
+    cmdArgMap_["-f"] = CmdArg::FILE;          // Input data is read from a file instead of the command line or stdin
+    cmdArgMap_["-serve"] = CmdArg::SERVE;     // Run as a server, formatting values sent over a unix socket
+    cmdArgMap_["-raw"] = CmdArg::RAW;         // Input is fixed size binary integer records instead of text
+    cmdArgMap_["-be"] = CmdArg::RAW_BE;       // The -raw records are big endian
+    cmdArgMap_["-le"] = CmdArg::RAW_LE;       // The -raw records are little endian (the default)
+    cmdArgMap_["-o"] = CmdArg::OUTPUT;        // Output format: the aligned table, or csv, tsv or json lines
+    cmdArgMap_["-cache"] = CmdArg::CACHE;     // Remember the formatted rows of this many distinct values
+    cmdArgMap_["-stats"] = CmdArg::STATS;     // Report timings and counts on stderr
+    cmdArgMap_["-l"] = CmdArg::LINES;         // Each line of the input is one value
+    cmdArgMap_["-maxmem"] = CmdArg::MAXMEM;   // Memory for the table rows. The rest go to a temporary file.
     cmdArgMap_["-h"] = CmdArg::HELP;
 }
 
+// Reads the value that follows the arg at i (for example the width of -i 16) into value, and moves i onto it. Returns
+// false if there is no value or it doesn't convert.
+template <typename T>
+static bool readArgValue(const std::vector<std::string> &args, size_t &i, T &value)
+{
+    if (i + 1 >= args.size()) {
+        return false;
+    }
+    std::istringstream argStream(args[++i]);
+    return static_cast<bool>(argStream >> value);
+}
+
+// Reads a count of minValue to maxValue, in decimal digits only (so -1 is an error instead of a huge number). Returns
+// false if it isn't one.
+static bool parseCount(const std::string &text, size_t minValue, size_t maxValue, size_t &count)
+{
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    errno = 0;
+    unsigned long long value = std::strtoull(text.c_str(), nullptr, 10);
+    if (errno == ERANGE || value < minValue || value > maxValue) {
+        return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+// Reads a size in bytes with an optional k, m or g suffix (powers of 1024). Returns false if it isn't one.
+static bool parseMemSize(const std::string &text, size_t &bytes)
+{
+    size_t digits = 0;
+    while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') {
+        ++digits;
+    }
+    if (digits == 0 || digits + 1 < text.size()) {
+        return false;
+    }
+    size_t shift = 0;
+    if (digits < text.size()) {
+        char suffix = static_cast<char>(std::tolower(static_cast<unsigned char>(text[digits])));
+        if (suffix == 'k') {
+            shift = 10;
+        } else if (suffix == 'm') {
+            shift = 20;
+        } else if (suffix == 'g') {
+            shift = 30;
+        } else {
+            return false;
+        }
+    }
+    errno = 0;
+    unsigned long long value = std::strtoull(text.c_str(), nullptr, 10);
+    if (errno == ERANGE || value > (SIZE_MAX >> shift)) {
+        return false;
+    }
+    bytes = static_cast<size_t>(value) << shift;
+    return true;
+}
+
 void FmtTool::parseArgs(std::stringstream *argStream)
+{
+    std::vector<std::string> args;
+    std::string tok;
+    while (*argStream >> tok) {
+        args.push_back(tok);
+    }
+    parseArgs(args);
+}
+
+void FmtTool::parseArgs(const std::vector<std::string> &args)
 {
     // populate both the vector of formatting types as well as the user values that we want to format.
     // For example, the user may specify a list of formats they want to see as well as a list of values they want to
@@ -30,12 +128,11 @@ void FmtTool::parseArgs(std::stringstream *argStream)
     // Example: -i 32 -i 64 -a 13 45 79
     // This means: format the values "13", "45" and "79" as 32 bit integer, 64 bit integer, and ascii characters
 
-    // Iterate over the stream of arguments
-    std::string userValues;
-    std::string tok;
+    // Iterate over the arguments
     int argsProcessed = 0;
-    std::unique_ptr<FmtType> newType = nullptr;
-    while (*argStream >> tok) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string &tok = args[i];
+        size_t argStart = i;
         size_t typeWidth = 0;  // not all types need a width.  default of 0 is ok.
         CmdArg currArg = cmdArgMap_[tok];
         switch(currArg) {
@@ -43,29 +140,124 @@ void FmtTool::parseArgs(std::stringstream *argStream)
             case (CmdArg::INT):
             case (CmdArg::UINT): {
                 // A width argument is required. Fetch it from the arg stream, converted to size_t
-                if (!(*argStream >> typeWidth)) {
+                if (!readArgValue(args, i, typeWidth)) {
                     THROW_FMT_EXCEPTION("-i and -u types require a width argument. (See fmttool -h for help)");
                 }
                 bool isSigned = (currArg == CmdArg::INT) ? true : false;
-                // base class pointer of derived class type
-                newType = std::make_unique<IntType>(typeWidth, isSigned, this);
-                fmtTypes_.insert(std::move(newType));  // std::set eliminates duplicates
+                formatter_.addIntType(typeWidth, isSigned);  // duplicates are eliminated
                 break;
             }
             case (CmdArg::ASCII): {
-                newType = std::make_unique<AsciiType>(this);
-                fmtTypes_.insert(std::move(newType));  // std::set eliminates duplicates
+                formatter_.addAsciiType();
                 break;
             }
             case (CmdArg::BINARY): {
-                newType = std::make_unique<BinaryType>(this);
-                fmtTypes_.insert(std::move(newType));  // std::set eliminates duplicates
+                formatter_.addBinaryType();
                 break;
             }
             // -nobin option suppresses the binary output column display for integer types (because it can be long and
             // maybe the user doesn't want it)
             case (CmdArg::SUPP_BIN): {
-                noBin_ = true;
+                formatter_.setBinaryFmtSuppressed(true);
+                break;
+            }
+            // -stream writes each row as soon as it is formatted. Column widths come from the format types rather than
+            // from a pass over the full table, so memory stays flat for endless piped input.
+            case (CmdArg::STREAM): {
+                stream_ = true;
+                break;
+            }
+            // -j <threads> formats on a pool of worker threads
+            case (CmdArg::JOBS): {
+                std::string count;
+                if (!readArgValue(args, i, count)) {
+                    THROW_FMT_EXCEPTION("-j requires a thread count argument. (See fmttool -h for help)");
+                }
+                if (!parseCount(count, 1, MAX_JOBS, numJobs_)) {
+                    THROW_FMT_EXCEPTION("Invalid thread count (-j <threads>). Must be 1 to " +
+                                        std::to_string(MAX_JOBS) + ".");
+                }
+                break;
+            }
+            // -f <file> reads the user values from a file. The file is memory mapped and tokenized in place.
+            // It can be given more than once. The files are then formatted at the same time (see MultiFileRunner).
+            case (CmdArg::FILE): {
+                if (!readArgValue(args, i, inFileName_)) {
+                    THROW_FMT_EXCEPTION("-f requires a file name argument. (See fmttool -h for help)");
+                }
+                inFileNames_.push_back(inFileName_);
+                continue;  // not one of the otherArgs_
+            }
+            // -serve <socket path> keeps running and formats values for clients of a unix socket (see FmtServer)
+            case (CmdArg::SERVE): {
+                if (!readArgValue(args, i, servePath_)) {
+                    THROW_FMT_EXCEPTION("-serve requires a socket path argument. (See fmttool -h for help)");
+                }
+                break;
+            }
+            // -raw <width> reads binary records of width bits from the file or stdin, with no text parsing.
+            case (CmdArg::RAW): {
+                if (!readArgValue(args, i, rawBits_)) {
+                    THROW_FMT_EXCEPTION("-raw requires a width argument. (See fmttool -h for help)");
+                }
+                if (rawBits_ != 8 && rawBits_ != 16 && rawBits_ != 32 && rawBits_ != 64) {
+                    THROW_FMT_EXCEPTION("Invalid width value for raw input (-raw <width>). Must be 8, 16, 32, or 64.");
+                }
+                break;
+            }
+            case (CmdArg::RAW_BE):
+            case (CmdArg::RAW_LE): {
+                rawBigEndian_ = (currArg == CmdArg::RAW_BE);
+                break;
+            }
+            // -o <format> picks the output format. table is the default.
+            case (CmdArg::OUTPUT): {
+                std::string outFormat;
+                if (!readArgValue(args, i, outFormat)) {
+                    THROW_FMT_EXCEPTION("-o requires an output format argument. (See fmttool -h for help)");
+                }
+                if (outFormat == "table") {
+                    recordWriter_.reset();
+                } else if (outFormat == "csv") {
+                    recordWriter_ = std::make_unique<RecordWriter>(out_, RecordWriter::Format::CSV);
+                } else if (outFormat == "tsv") {
+                    recordWriter_ = std::make_unique<RecordWriter>(out_, RecordWriter::Format::TSV);
+                } else if (outFormat == "jsonl") {
+                    recordWriter_ = std::make_unique<RecordWriter>(out_, RecordWriter::Format::JSONL);
+                } else {
+                    THROW_FMT_EXCEPTION("Invalid output format (-o <format>). Must be table, csv, tsv or jsonl.");
+                }
+                break;
+            }
+            // -cache <entries> reuses the formatted row of a value that was seen recently (see FmtCache)
+            case (CmdArg::CACHE): {
+                std::string count;
+                if (!readArgValue(args, i, count)) {
+                    THROW_FMT_EXCEPTION("-cache requires a number of entries argument. (See fmttool -h for help)");
+                }
+                if (!parseCount(count, 0, MAX_CACHE_ENTRIES, cacheSize_)) {
+                    THROW_FMT_EXCEPTION("Invalid cache size (-cache <entries>). Must be 0 (no cache) to " +
+                                        std::to_string(MAX_CACHE_ENTRIES) + ".");
+                }
+                break;
+            }
+            // -l takes each line of the file or stdin as one value, spaces and all, instead of splitting at white space
+            case (CmdArg::LINES): {
+                lineMode_ = true;
+                break;
+            }
+            // -maxmem <size> caps the memory used by the rows of the table. Past that they are spilled to a temporary
+            // file and read back for display.
+            case (CmdArg::MAXMEM): {
+                std::string size;
+                if (!readArgValue(args, i, size) || !parseMemSize(size, maxMem_)) {
+                    THROW_FMT_EXCEPTION("-maxmem requires a size argument such as 64m. (See fmttool -h for help)");
+                }
+                break;
+            }
+            // -stats reports where the time went, and how many values failed to format, on stderr at the end
+            case (CmdArg::STATS): {
+                showStats_ = true;
                 break;
             }
             // -h for help. Does not have any args.
@@ -73,35 +265,84 @@ void FmtTool::parseArgs(std::stringstream *argStream)
                 helpRequested_ = true;
                 break;
             }
-            // Assume any other arg data are the users data values to format. Append these to a string which we will
-            // later convert into an istream for parsing.
+            // Assume any other arg data are the users data values to format. Each arg is one value, even if it has
+            // white space in it (a quoted string from the shell).
             default: {
-                userValues += " " + tok;
+                if (!tok.empty()) {
+                    userValues_.push_back(tok);
+                }
                 break;
             }
         }
+        otherArgs_.insert(otherArgs_.end(), args.begin() + argStart, args.begin() + i + 1);
+    }
+
+    // The server splits each request at white space and answers it with tab separated lines, formatted on its own
+    // thread with no table, cache or stats (see FmtServer). The options for those would do nothing there, so they are
+    // refused rather than silently ignored.
+    if (!servePath_.empty()) {
+        std::string ignoredOpt;
+        if (lineMode_) {
+            ignoredOpt = "-l";
+        } else if (recordWriter_) {
+            ignoredOpt = "-o csv, tsv or jsonl";
+        } else if (cacheSize_ != 0) {
+            ignoredOpt = "-cache";
+        } else if (showStats_) {
+            ignoredOpt = "-stats";
+        } else if (stream_) {
+            ignoredOpt = "-stream";
+        } else if (maxMem_ != 0) {
+            ignoredOpt = "-maxmem";
+        } else if (numJobs_ != 1) {
+            ignoredOpt = "-j";
+        }
+        if (!ignoredOpt.empty()) {
+            THROW_FMT_EXCEPTION(ignoredOpt + " can't be used with -serve. The server only takes the format options.");
+        }
     }
 
     // If there were no args given for type format requests (only user values), then assign a dft formatting config.
     // User will get failures though if the data isn't the default here (say its ascii or something)
-    if (fmtTypes_.empty()) {
+    // The record formats are always written as the rows are formatted, the same as -stream.
+    if (recordWriter_) {
+        stream_ = true;
+    }
+
+    if (!formatter_.hasFmtTypes()) {
         // For consistency, this should match the DFT_ARGS variable options
-        newType = std::make_unique<IntType>(32, true, this);  // base class pointer of derived class type
-        fmtTypes_.insert(std::move(newType));     // std::set eliminates duplicates
+        formatter_.addIntType(32, true);
     }
 
-    if (!userValues.empty()) {
-        // Create an istringstream with unique ptr.  This will be destroyed by destructor.
-        // Save a copy of this pointer into the inStream_ reference.  This does not get destroyed as it is a reference
-        // only.
-        // This is the user data that they gave on command line.
-        iSStream_ = std::make_unique<std::istringstream>(userValues);
-        inStream_ = iSStream_.get();
-    } else {
+    if (rawBits_ != 0 && lineMode_) {
+        THROW_FMT_EXCEPTION("-l is for text input. It can't be used with -raw.");
+    }
+    if (rawBits_ != 0 && (!userValues_.empty() || !servePath_.empty())) {
+        THROW_FMT_EXCEPTION("-raw input is read from a file (-f) or stdin. It can't be used with user data or -serve.");
+    }
+    InputTokenizer::Mode tokenizerMode = (lineMode_) ? InputTokenizer::Mode::LINES : InputTokenizer::Mode::TOKENS;
+    if (!servePath_.empty()) {
+        // The values come from the clients. There is no input of our own.
+        if (!userValues_.empty() || !inFileName_.empty()) {
+            THROW_FMT_EXCEPTION("User data and input files (-f) can't be given together with -serve.");
+        }
+    } else if (!inFileName_.empty()) {
+        if (!userValues_.empty()) {
+            THROW_FMT_EXCEPTION("User data can't be given on the command line together with an input file (-f).");
+        }
+        if (inFileNames_.size() > 1) {
+            return;  // each file gets its own FmtTool, see formatFiles()
+        }
+        // The values are read straight out of the mapping. No stream is used at all.
+        mappedFile_ = std::make_unique<MappedFile>(inFileName_);
+        mapPos_ = 0;
+        if (rawBits_ == 0) {
+            tokenizer_ = std::make_unique<InputTokenizer>(mappedFile_->getData(), tokenizerMode);
+        }
+    } else if (userValues_.empty() && rawBits_ == 0) {
         // user didn't give any data, so we assume the data is coming from live input, either from command line or from
-        // an input pipe.
-        // iSStream remains nullptr and is not used
-        inStream_ = &std::cin;
+        // an input pipe. The user data given on the command line is used as is, it needs no tokenizer.
+        tokenizer_ = std::make_unique<InputTokenizer>(STDIN_FILENO, tokenizerMode);
     }
 }
 
@@ -123,12 +364,59 @@ bool FmtTool::showHelp()
                   << "       (Supported bit-widths: 8,16,32,64)\n"
                   << "    -a\n"
                   << "       Format the data as input ascii characters, showing their hexadecimal values for each character.\n"
+                  << "       Each character is always 2 hex digits (a tab is 09, a byte of 0xe9 is e9).\n"
                   << "       Assumes single byte ascii characters. UTF8 or graphic/multi-byte characters not suppored.\n"
                   << "       From the shell, enclose bigger strings in \" characters if there are whitespace characters in the data.\n"
                   << "    -b\n"
                   << "       Formats the data into ascii characters. Input must be in the format of hexademical data prefixed with 0x\n"
                   << "       Input data must contain even number of charactes so that bytes are well-formed (nibbles are not suppported).\n"
                   << "       Correct example: 0x51    Invalid example: 0x4\n"
+                  << "       The digits may be upper or lower case, and there is no limit on the length.\n"
+                  << "    -nobin\n"
+                  << "       Suppress the binary column for integer types.\n"
+                  << "    -stream\n"
+                  << "       Write each row as soon as it is formatted instead of waiting for all of the input.\n"
+                  << "       Column widths are taken from the widest value each format can produce. Columns that have no\n"
+                  << "       upper bound (the input, ascii and binary) widen as longer values arrive.\n"
+                  << "       Useful for large or never-ending piped input.\n"
+                  << "    -j threads\n"
+                  << "       Format on the given number of worker threads (1 to 1024). Output keeps the input order.\n"
+                  << "       Worth it for large piped input. The default of 1 formats on the main thread.\n"
+                  << "    -f file\n"
+                  << "       Read the user data from a file instead of the command line or stdin. The file is memory mapped\n"
+                  << "       and the values are used in place without copying, which is the fastest way to format a large file.\n"
+                  << "       Give -f more than once to format several files at the same time, each on its own thread with its\n"
+                  << "       own table. The tables are written one after the other, in order, each after a ==> file <== line.\n"
+                  << "    -l\n"
+                  << "       Each line of the -f file or stdin is one value, white space and all, instead of each word.\n"
+                  << "       Empty lines are skipped.\n"
+                  << "    -raw width [-be|-le]\n"
+                  << "       Read the user data as fixed size binary integer records of the given bit width (8,16,32,64) from\n"
+                  << "       the -f file or stdin, instead of as text. Records are little endian unless -be is given.\n"
+                  << "       Each record formats the same as its hex text would (0x and the record's digits), which is also\n"
+                  << "       what the input column shows.\n"
+                  << "    -serve socket_path\n"
+                  << "       Keep running and format the values sent by clients to a unix domain socket at the given path.\n"
+                  << "       The format options are set once, here. Each request and response is a 4 byte big endian length\n"
+                  << "       followed by that many bytes. A request holds white space separated values. The response has one\n"
+                  << "       line per value with the formatted columns separated by tabs. Stop the server with SIGINT or SIGTERM.\n"
+                  << "       -l, -o csv|tsv|jsonl, -cache, -stats, -stream, -maxmem and -j can't be used with it.\n"
+                  << "    -o table|csv|tsv|jsonl\n"
+                  << "       Output format. table (the default) is the aligned table. csv and tsv write a header line of\n"
+                  << "       column names then one line per value. jsonl writes one JSON object per value, keyed by column name.\n"
+                  << "       These are written as the values are formatted (like -stream) with no padding.\n"
+                  << "    -cache entries\n"
+                  << "       Keep the formatted rows of up to this many distinct values (per -j thread) and reuse them when a\n"
+                  << "       value repeats. Worth it when the input repeats a lot. Hit and miss counts are shown on stderr.\n"
+                  << "       Up to 16777216 entries. 0 (the default) turns the cache off.\n"
+                  << "    -maxmem size\n"
+                  << "       Keep at most about this many bytes of formatted rows in memory (k, m or g suffixes are allowed).\n"
+                  << "       The rest are spilled to a temporary file in $TMPDIR (or /tmp) and read back to write the table,\n"
+                  << "       which comes out the same. Not needed with -stream or -o, which don't keep the rows.\n"
+                  << "    -stats\n"
+                  << "       At the end, show on stderr the time spent reading, formatting (per format type), storing and\n"
+                  << "       writing, tokens and bytes per second, the valid/out_of_range/invalid result counts of each format\n"
+                  << "       type, a histogram of the time per value of each format type, and the peak memory use.\n"
                   << "    -h\n"
                   << "       Shows this help text.\n"
                   << "\nuser_data\n"
@@ -138,160 +426,567 @@ bool FmtTool::showHelp()
                   << "       fmttool -i 16 -u 64 12 78\n"
                   << "    Format the strings \"hello\" and \"world\" individually, given as input from a pipe in ascii mode\n"
                   << "       echo \"hello world\" | fmttool -a\n"
+                  << "    Format each line of a file as one string\n"
+                  << "       fmttool -l -a -f notes.txt\n"
                   << std::endl;
     }
     return helpRequested_;
 }
 
+bool FmtTool::serve()
+{
+    // Like showHelp(), returns true if the args asked for this mode (and it has finished).
+    if (servePath_.empty()) {
+        return false;
+    }
+    FmtServer server(servePath_, formatter_);
+    server.run();
+    return true;
+}
+
+bool FmtTool::formatFiles(bool &allFormatted)
+{
+    // Like serve(), returns true if the args asked for this (more than one -f file) and it has finished.
+    // allFormatted is set to false if any of the files failed.
+    if (inFileNames_.size() < 2) {
+        return false;
+    }
+    out_.flush();
+    MultiFileRunner runner(otherArgs_, inFileNames_, out_.getFd());
+    allFormatted = runner.run();
+    return true;
+}
+
 void FmtTool::addTitles()
 {
     const std::string INPUT_TITLE = "input";
-    FmtColList titleRow1;
-    FmtColList titleRow2;
-    FmtColList underscoreRow;
 
     // for each format type request, do a lookup into the titles and widths for a title bar of the table.
     // The title consists of 3 lines, the titles themselves have 2 lines, and the 3rd line is an underscore line.
     // Getting these titles produces a vector of pairs (data paired with display width).
+    titleRow1_.clear();
+    titleRow2_.clear();
+    underscoreRow_.clear();
 
     // First column, the user input.  We always show this as the first column. The first row of this title is
     // empty string.
-    titleRow1.emplace_back("", INPUT_TITLE.size());
-    titleRow2.emplace_back(INPUT_TITLE, INPUT_TITLE.size());
-    underscoreRow.emplace_back("", INPUT_TITLE.size());
+    titleRow1_.emplace_back("", INPUT_TITLE.size());
+    titleRow2_.emplace_back(INPUT_TITLE, INPUT_TITLE.size());
+    underscoreRow_.emplace_back("", INPUT_TITLE.size());
 
     // Then, add the rest of the columns.  Each FmtType might add more than one
-    for (const auto &fmtType : fmtTypes_) {
-        fmtType->getTitleRow(titleRow1, titleRow2, underscoreRow);
+    formatter_.getTitleRow(titleRow1_, titleRow2_, underscoreRow_);
+
+    if (recordWriter_) {
+        // Each column is named by its two title lines (for example "Base 10 int16_t"). No widths are needed.
+        std::vector<std::string> names;
+        for (size_t i = 0; i < titleRow1_.size(); ++i) {
+            names.push_back(titleRow1_[i].first.empty() ? titleRow2_[i].first
+                                                        : titleRow1_[i].first + " " + titleRow2_[i].first);
+        }
+        recordWriter_->writeHeader(names);
+        return;
+    }
+
+    if (stream_) {
+        // Nothing is stored in stream mode. Fix up the widths and show the titles right away.
+        prepareStreamWidths(titleRow1_);
+        applyStreamWidths(titleRow1_);
+        applyStreamWidths(titleRow2_);
+        applyStreamWidths(underscoreRow_);
+        showRow(titleRow1_);
+        showRow(titleRow2_);
+        showUnderscoreRow(underscoreRow_);
+        return;
+    }
+
+    // The titles are not stored in the table, but the columns must be at least as wide as them.
+    results_.initColumns(titleRow1_.size());
+    results_.setMemoryLimit(maxMem_);
+    for (size_t i = 0; i < titleRow1_.size(); ++i) {
+        results_.widenColumn(i, std::max({titleRow1_[i].second, titleRow2_[i].second, underscoreRow_[i].second}));
     }
-    results_.push_back(titleRow1);  // adds the title row
-    results_.push_back(titleRow2);  // adds the title row
-    results_.push_back(underscoreRow);  // adds the underscore row
 }
 
 void FmtTool::executeFormatting()
 {
     // We have a list of values coming from our chosen input stream (it may be a istringtream or it might be std::cin).
     // For each value, execute the requested formatting against that value.
-    bool moreData = true;
-    bool enclosedData = false;
-    std::string currValue;
-    std::string compoundString;
+    startTime_ = FmtStats::Clock::now();
     addTitles();
-    while (moreData) {
-        if (*inStream_ >> currValue) {
-            if (!enclosedData) {
-                if (currValue[0] == '\2') {
-                    // An enclosed string.  Strip the STX character and start creating our compound string.
-                    enclosedData = true;
-                    compoundString = currValue.substr(1, currValue.size() - 1);
-                } else {
-                    // Normal case, we are not in an enclused string and its just a new single token of data.
-                    addToResultTable(currValue);  // formats the value into the result table
-                }
-            } else {
-                // We are already in enclosed data string. if the token does not end in the ETX, append it.
-                // It the token ends in ETX, append it without the ETX, and then drive the format work.
-                if (currValue[currValue.size() - 1] == '\3') {
-                    compoundString += " " + currValue.substr(0, currValue.size() - 1);
-                    addToResultTable(compoundString);
-                } else {
-                    compoundString += " " + currValue;
+    std::vector<std::string> typeNames;
+    formatter_.getFmtTypeNames(typeNames);
+    workerStats_.assign(numJobs_, FmtStats());
+    for (auto &stats : workerStats_) {
+        stats.initTypes(typeNames);
+    }
+    caches_.clear();
+    workerScratch_.clear();
+    workerScratch_.resize(numJobs_);
+    for (size_t i = 0; i < numJobs_; ++i) {
+        // Room for the formatter's scratch and, with -cache, for formatCachedValues() to lay out a full batch of
+        // lookups and misses, plus alignment slack
+        workerScratch_[i].arenaSize = FmtFormatter::SCRATCH_SIZE;
+        if (cacheSize_ > 0) {
+            caches_.push_back(std::make_unique<FmtCache>(cacheSize_, formatter_.getColumnCount()));
+            workerScratch_[i].arenaSize += BATCH_SIZE * (3 * sizeof(size_t) + sizeof(std::string_view) +
+                                                         sizeof(uint64_t) + 4 * sizeof(uint32_t)) + 256;
+        }
+        workerScratch_[i].arenaBuf = std::make_unique<char[]>(workerScratch_[i].arenaSize);
+    }
+    if (numJobs_ > 1) {
+        // Read, format and write on separate threads. The pipeline hands the rows back in input order.
+        FmtPipeline pipeline(numJobs_,
+            [this](FmtPipeline::InputBatch &input) { return readBatch(input); },
+            [this](size_t worker, const FmtPipeline::InputBatch &input, std::vector<FmtColumnData> &cols) {
+                formatBatch(worker, input, cols);
+            },
+            [this](const std::vector<FmtColumnData> &cols) { storeBatch(cols); },
+            [this]() {
+                if (stream_) {
+                    out_.flush();
                 }
+            });
+        pipeline.run();
+    } else {
+        // The values are read, formatted and stored a batch at a time. The batch buffers are reused throughout.
+        FmtPipeline::InputBatch input;
+        std::vector<FmtColumnData> cols;
+        bool moreData = true;
+        while (moreData) {
+            // In stream mode, push out what we have before we block waiting on more input. That way a live pipe sees
+            // its rows right away, while a fast producer still gets the benefit of buffered output.
+            if (stream_ && !isInputReady()) {
+                out_.flush();
             }
-        } else if (inStream_->eof()) {
-            // normal exit case.  We reached the end of the stream, or pipe/stream ended
-            moreData = false;
-        } else if (inStream_->bad()) {
-            THROW_FMT_EXCEPTION("Input stream error.");
-        } else {
-            // Should not happen.
-            THROW_FMT_EXCEPTION("Unexpected stream error.");
-        }   
+            moreData = readBatch(input);
+            if (!input.values.empty()) {
+                formatBatch(0, input, cols);
+                storeBatch(cols);
+            }
+        }
+    }
+    // The table of formatted data is created. The result table kept the column widths up to date as rows were
+    // added, so there is nothing more to compute before display.
+}
+
+bool FmtTool::isInputReady()
+{
+    // True if the next value can be read without waiting on the input.
+    if (mappedFile_) {
+        return true;  // the whole file is already there
     }
-    // The table of formatted data is created. Now, do a pass through it to compute column widths for nice display.
-    prepareTableForDisplay();
+    if (rawBits_ != 0) {
+        // A whole record buffered, or more bytes waiting on stdin
+        if (rawLen_ - rawPos_ >= rawBits_ / 8) {
+            return true;
+        }
+        pollfd inPoll = {STDIN_FILENO, POLLIN, 0};
+        return !rawEof_ && poll(&inPoll, 1, 0) > 0;
+    }
+    if (tokenizer_) {
+        return tokenizer_->isInputReady();
+    }
+    return true;  // the command line values are all there
 }
 
-void FmtTool::addToResultTable(const std::string &value)
+bool FmtTool::readBatch(FmtPipeline::InputBatch &input)
 {
-    // for each format type request, drive the formatting against the data.
-    // Formatting of each fmt type appends to a vector of pairs (data paired with display width)
-    FmtColList outputCols;
-    outputCols.emplace_back(value, value.size());  // Always add the user input string as first column
-    for (const auto &fmtType : fmtTypes_) {
-        fmtType->format(outputCols, value);
-    }
-    results_.push_back(outputCols);  // adds this formatted row to the result table
+    // Reads up to BATCH_SIZE values. Returns false at the end of the input.
+    // The time for this includes any time spent waiting on the input.
+    FmtStats::Clock::time_point start = FmtStats::Clock::now();
+    bool moreData = (rawBits_ != 0) ? readRawBatch(input) : readTextBatch(input);
+    uint64_t numBytes = 0;
+    if (rawBits_ != 0) {
+        numBytes = input.values.size() * (rawBits_ / 8);
+    } else {
+        for (const auto &value : input.values) {
+            numBytes += value.size();
+        }
+    }
+    readStats_.addInput(input.values.size(), numBytes);
+    readStats_.addStage(FmtStats::Stage::READ, FmtStats::nsSince(start));
+    return moreData;
 }
 
-void FmtTool::prepareTableForDisplay()
+bool FmtTool::readTextBatch(FmtPipeline::InputBatch &input)
 {
-    // Loops over all the data and find a common width for each column displaying the table
-    auto resultsIter = std::begin(results_);
-    std::vector<size_t> savedWidths(resultsIter->size(), 0);  // all saved widths have 0 width to start.
-    while (resultsIter != std::end(results_)) {
-        // for each column of the row, check if the width is greater than the saved width for that column
-        auto savedWidthsIter = std::begin(savedWidths);
-        auto colIter = std::cbegin(*resultsIter);
-        while (colIter != std::cend(*resultsIter)) {
-            if (colIter->second > *savedWidthsIter) {
-                (*savedWidthsIter) = colIter->second;  // assign the larger value to the final width
+    // Tokenizes up to BATCH_SIZE values from the file or stdin. Those from stdin are backed by the batch's own text
+    // buffer, so they stay put while the next batch is read.
+    if (tokenizer_) {
+        return tokenizer_->readBatch(input.values, BATCH_SIZE, input.text);
+    }
+
+    // The command line values are used where they are.
+    size_t count = std::min(BATCH_SIZE, userValues_.size() - userPos_);
+    input.values.assign(userValues_.begin() + userPos_, userValues_.begin() + userPos_ + count);
+    userPos_ += count;
+    return userPos_ < userValues_.size();
+}
+
+bool FmtTool::readRawBatch(FmtPipeline::InputBatch &input)
+{
+    // Takes up to BATCH_SIZE whole records from the mapped file or from stdin, and turns them into numbers with the
+    // record loader kernel. Nothing is parsed.
+    const size_t recSize = rawBits_ / 8;
+    const char *src;
+    size_t count;
+    bool moreData;
+    if (mappedFile_) {
+        std::string_view data = mappedFile_->getData();
+        count = std::min((data.size() - mapPos_) / recSize, BATCH_SIZE);
+        src = data.data() + mapPos_;
+        mapPos_ += count * recSize;
+        moreData = (data.size() - mapPos_ >= recSize);
+        if (!moreData && mapPos_ != data.size()) {
+            THROW_FMT_EXCEPTION("The raw input file " + inFileName_ + " does not hold a whole number of records.");
+        }
+    } else {
+        // stdin is read with plain read() calls into our own buffer. std::cin is not used at all for raw input. We
+        // wait for one whole record at most, and take however many whole records that gives us. That keeps a live
+        // pipe flowing.
+        if (rawBuf_.empty()) {
+            rawBuf_.resize(BATCH_SIZE * sizeof(uint64_t));
+        }
+        if (rawPos_ > 0) {
+            std::copy(rawBuf_.begin() + rawPos_, rawBuf_.begin() + rawLen_, rawBuf_.begin());
+            rawLen_ -= rawPos_;
+            rawPos_ = 0;
+        }
+        while (rawLen_ < recSize && !rawEof_) {
+            ssize_t numRead = read(STDIN_FILENO, rawBuf_.data() + rawLen_, rawBuf_.size() - rawLen_);
+            if (numRead > 0) {
+                rawLen_ += static_cast<size_t>(numRead);
+            } else if (numRead == 0) {
+                rawEof_ = true;
+            } else if (errno != EINTR) {
+                THROW_FMT_EXCEPTION(std::string("Input stream error: ") + std::strerror(errno));
             }
-            ++savedWidthsIter;
-            ++colIter;
         }
-        ++resultsIter;
-    }
-
-    // Now that the optimal widths are computed, change all the widths of each value
-    // Technically this is a bit wasteful since we only have one row of final widths, but its easier for the
-    // displayer code if doesn't have to iterate a second vector.
-    for (auto &currentRow : results_) {
-        auto colIter = std::begin(currentRow);
-        auto savedWidthsIter = std::begin(savedWidths);
-        while (colIter != std::end(currentRow)) {
-            colIter->second = *savedWidthsIter;
-            ++savedWidthsIter;
-            ++colIter;
+        count = std::min(rawLen_ / recSize, BATCH_SIZE);
+        src = rawBuf_.data();
+        rawPos_ = count * recSize;
+        moreData = !(rawEof_ && rawLen_ - rawPos_ < recSize);
+        if (!moreData && rawPos_ != rawLen_) {
+            THROW_FMT_EXCEPTION("The raw input ended in the middle of a record.");
         }
     }
+
+    input.rawValues.resize(count);
+    FmtKernels::loadRecords(input.rawValues.data(), src, count, recSize, rawBigEndian_);
+
+    // The input column shows each record as its hex text, the same text that would format the same way.
+    const size_t textLen = 2 + recSize * 2;
+    input.rawText.resize(count * textLen);
+    input.values.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        char *dst = &input.rawText[i * textLen];
+        dst[0] = '0';
+        dst[1] = 'x';
+        FmtKernels::writeHex(dst + 2, input.rawValues[i], recSize);
+        input.values[i] = std::string_view(dst, textLen);
+    }
+    return moreData;
 }
 
-void FmtTool::showRow(ResultTable::const_iterator &resultsIter)
+void FmtTool::formatBatch(size_t worker, const FmtPipeline::InputBatch &input, std::vector<FmtColumnData> &cols)
 {
-    for (const auto &colPair : *resultsIter) {
-        std::cout << std::setw(colPair.second) << colPair.first << std::setfill(' ') << std::setw(COL_SPACE) << "";
+    const std::vector<std::string_view> &values = input.values;
+    // The input column, then the formatter's columns.
+    // This only reads the tool's settings and the worker's own cache and scratch, so it is safe to call from several
+    // pipeline workers at once.
+    size_t numCols = formatter_.getColumnCount() + 1;
+    if (cols.size() != numCols) {
+        cols.clear();
+        cols.resize(numCols);
+    }
+    FmtStats::Clock::time_point start = FmtStats::Clock::now();
+    uint64_t startAllocs = AllocCounter::getThreadCount();
+    for (auto &col : cols) {
+        col.clear();
+    }
+    // Always add the user input string as first column
+    for (const auto &value : values) {
+        cols[0].append(value);
     }
-    std::cout << "\n"; 
+    FmtStats *stats = showStats_ ? &workerStats_[worker] : nullptr;
+    // Whatever only lives for this batch comes out of an arena over the worker's scratch buffer, which is simply
+    // dropped at the end. Only a batch bigger than BATCH_SIZE would spill to the heap.
+    WorkerScratch &scratch = workerScratch_[worker];
+    std::pmr::monotonic_buffer_resource arena(scratch.arenaBuf.get(), scratch.arenaSize);
+    if (caches_.empty()) {
+        formatValues(values.data(), input.rawValues.data(), values.size(), &cols[1], stats, &arena);
+    } else {
+        formatCachedValues(worker, input, cols, stats, arena);
+    }
+    workerStats_[worker].addFormatAllocs(AllocCounter::getThreadCount() - startAllocs);
+    workerStats_[worker].addStage(FmtStats::Stage::FORMAT, FmtStats::nsSince(start));
 }
 
-void FmtTool::displayResultTable()
+void FmtTool::formatValues(const std::string_view *values, const uint64_t *rawValues, size_t count,
+                           FmtColumnData *cols, FmtStats *stats, std::pmr::memory_resource *scratch) const
 {
-    auto resultsIter = std::cbegin(results_);
-
-    // first 2 rows are the title
-    showRow(resultsIter);
-    ++resultsIter;
-    showRow(resultsIter);
-    ++resultsIter;
-    
-    // 3rd row is the underscore lines
-    for (const auto &colPair : *resultsIter) {
+    // Runs the formatters, filling the formatter's columns (cols). rawValues is only used for -raw input.
+    if (rawBits_ != 0) {
+        formatter_.formatRawBatch(rawValues, values, count, rawBits_, cols, stats, scratch);
+    } else {
+        formatter_.formatBatch(values, count, cols, stats, scratch);
+    }
+}
+
+void FmtTool::formatCachedValues(size_t worker, const FmtPipeline::InputBatch &input,
+                                 std::vector<FmtColumnData> &cols, FmtStats *stats,
+                                 std::pmr::memory_resource &arena)
+{
+    // Every value is looked up first. The distinct misses are formatted together as one smaller batch, once each:
+    // a value that repeats one that missed earlier in the batch takes that miss's row (and counts as a hit). Then the
+    // rows are put together in input order, from the cache or from the fresh results. The misses only go into the
+    // cache at the very end, so that they can't push out an entry this batch still has to copy from.
+    FmtCache &cache = *caches_[worker];
+    WorkerScratch &scratch = workerScratch_[worker];
+    const std::vector<std::string_view> &values = input.values;
+
+    // The lookup results, the distinct misses and a small open addressing table of them (the miss row + 1 in each
+    // used slot) only live for this batch, so they come out of the batch's arena
+    std::pmr::vector<size_t> entries(values.size(), &arena);
+    std::pmr::vector<size_t> missRows(values.size(), &arena);  // for a value with no entry: its row of missCols
+    std::pmr::vector<std::string_view> missValues(&arena);
+    std::pmr::vector<size_t> missHashes(&arena);
+    std::pmr::vector<uint64_t> missRawValues(&arena);
+    missValues.reserve(values.size());
+    missHashes.reserve(values.size());
+    if (rawBits_ != 0) {
+        missRawValues.reserve(values.size());
+    }
+    size_t numMissSlots = 16;
+    while (numMissSlots < values.size() * 2) {
+        numMissSlots *= 2;
+    }
+    const size_t missMask = numMissSlots - 1;
+    std::pmr::vector<uint32_t> missSlots(numMissSlots, 0, &arena);
+    for (size_t i = 0; i < values.size(); ++i) {
+        size_t hash = FmtCache::hashKey(values[i]);
+        size_t slot = hash & missMask;
+        while (missSlots[slot] != 0 && (missHashes[missSlots[slot] - 1] != hash ||
+                                        missValues[missSlots[slot] - 1] != values[i])) {
+            slot = (slot + 1) & missMask;
+        }
+        if (missSlots[slot] != 0) {
+            entries[i] = FmtCache::NO_ENTRY;
+            missRows[i] = missSlots[slot] - 1;
+            cache.countHit();
+            continue;
+        }
+        entries[i] = cache.find(values[i], hash);
+        if (entries[i] == FmtCache::NO_ENTRY) {
+            missRows[i] = missValues.size();
+            missSlots[slot] = static_cast<uint32_t>(missValues.size() + 1);
+            missValues.push_back(values[i]);
+            missHashes.push_back(hash);
+            if (rawBits_ != 0) {
+                missRawValues.push_back(input.rawValues[i]);
+            }
+        }
+    }
+
+    // The formatter's columns for the misses. They keep their buffers from one batch to the next.
+    std::vector<FmtColumnData> &missCols = scratch.missCols;
+    if (missCols.size() != formatter_.getColumnCount()) {
+        missCols.clear();
+        missCols.resize(formatter_.getColumnCount());
+    }
+    for (auto &col : missCols) {
+        col.clear();
+    }
+    if (!missValues.empty()) {
+        formatValues(missValues.data(), missRawValues.data(), missValues.size(), missCols.data(), stats, &arena);
+    }
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        for (size_t col = 1; col < cols.size(); ++col) {
+            cols[col].append((entries[i] != FmtCache::NO_ENTRY) ? cache.getCell(entries[i], col - 1)
+                                                                 : missCols[col - 1].getCell(missRows[i]));
+        }
+    }
+    for (size_t row = 0; row < missValues.size(); ++row) {
+        cache.insert(missValues[row], missCols.data(), row);
+    }
+}
+
+void FmtTool::showCacheStats()
+{
+    // Reported on stderr, so they never mix with the formatted output.
+    if (caches_.empty()) {
+        return;
+    }
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    for (const auto &cache : caches_) {
+        hits += cache->getHits();
+        misses += cache->getMisses();
+        evictions += cache->getEvictions();
+    }
+    uint64_t lookups = hits + misses;
+    std::cerr << "cache: " << hits << " hits, " << misses << " misses, " << evictions << " evictions ("
+              << ((lookups > 0) ? (hits * 100 / lookups) : 0) << "% hit rate)" << std::endl;
+}
+
+void FmtTool::showStats()
+{
+    // Also on stderr. The stats of every thread are added up here, after they have all finished.
+    if (!showStats_) {
+        return;
+    }
+    FmtStats total = readStats_;
+    for (const auto &stats : workerStats_) {
+        total.merge(stats);
+    }
+    total.merge(writeStats_);
+    std::cerr << total.toString(FmtStats::nsSince(startTime_)) << std::flush;
+}
+
+void FmtTool::storeBatch(const std::vector<FmtColumnData> &cols)
+{
+    FmtStats::Clock::time_point start = FmtStats::Clock::now();
+    if (!stream_) {
+        results_.addBatch(cols);  // adds the formatted rows to the result table
+    } else if (recordWriter_) {
+        // written immediately, never stored
+        recordWriter_->writeBatch(cols);
+    } else {
+        size_t numRows = cols.empty() ? 0 : cols[0].size();
+        for (size_t row = 0; row < numRows; ++row) {
+            for (size_t col = 0; col < cols.size(); ++col) {
+                std::string_view cell = cols[col].getCell(row);
+                showCell(cell, getStreamWidth(col, cell.size()));
+            }
+            out_.write("\n");
+        }
+    }
+    writeStats_.addStage(FmtStats::Stage::STORE, FmtStats::nsSince(start));
+}
+
+void FmtTool::prepareStreamWidths(const FmtColList &titleRow)
+{
+    // Start from the title widths, then widen each column to the largest value its format type can ever produce.
+    // The first column is the user input which has no upper bound.
+    std::vector<size_t> maxWidths;
+    maxWidths.push_back(0);
+    formatter_.getColumnWidths(maxWidths);
+    if (maxWidths.size() != titleRow.size()) {
+        THROW_FMT_EXCEPTION("Column width count does not match the title columns.");
+    }
+
+    streamWidths_.clear();
+    streamGrowCols_.clear();
+    for (size_t i = 0; i < titleRow.size(); ++i) {
+        streamWidths_.push_back(std::max(titleRow[i].second, maxWidths[i]));
+        streamGrowCols_.push_back(maxWidths[i] == 0);
+    }
+}
+
+void FmtTool::applyStreamWidths(FmtColList &row)
+{
+    // Assign the stream widths to the row before showing it. Unbounded columns can't be known up front, so they are
+    // widened to the longest value seen so far. Earlier rows are already written and will not line up with a later
+    // wider value, but the fixed width columns always do.
+    auto savedWidthsIter = std::begin(streamWidths_);
+    auto growIter = std::cbegin(streamGrowCols_);
+    for (auto &colPair : row) {
+        if (colPair.second > *savedWidthsIter && *growIter) {
+            (*savedWidthsIter) = colPair.second;
+        }
+        colPair.second = std::max(colPair.second, *savedWidthsIter);
+        ++savedWidthsIter;
+        ++growIter;
+    }
+}
+
+size_t FmtTool::getStreamWidth(size_t col, size_t dataWidth)
+{
+    // Same as applyStreamWidths(), for a single cell
+    if (dataWidth > streamWidths_[col] && streamGrowCols_[col]) {
+        streamWidths_[col] = dataWidth;
+    }
+    return std::max(dataWidth, streamWidths_[col]);
+}
+
+void FmtTool::showCell(std::string_view data, size_t width)
+{
+    out_.writePadded(data, width);
+    out_.fill(' ', COL_SPACE);
+}
+
+void FmtTool::showRow(const FmtColList &row)
+{
+    for (const auto &colPair : row) {
+        showCell(colPair.first, colPair.second);
+    }
+    out_.write("\n");
+}
+
+void FmtTool::showUnderscoreRow(const FmtColList &row)
+{
+    for (const auto &colPair : row) {
         // empty string with fill character to make the underscores
         if (!colPair.first.empty()) {
             THROW_FMT_EXCEPTION("Underscore line expected to have empty value.");
         }
-        std::cout << std::setfill('-') << std::setw(colPair.second) << colPair.first << std::setfill(' ')
-                  << std::setw(COL_SPACE) << "";
+        out_.fill('-', colPair.second);
+        out_.fill(' ', COL_SPACE);
     }
-    std::cout << "\n";
-    ++resultsIter;
+    out_.write("\n");
+}
 
-    while (resultsIter != std::cend(results_)) {
-        showRow(resultsIter);
-        ++resultsIter;
+void FmtTool::displayResultTable()
+{
+    FmtStats::Clock::time_point start = FmtStats::Clock::now();
+    writeResultTable();
+    writeStats_.addStage(FmtStats::Stage::DISPLAY, FmtStats::nsSince(start));
+    showCacheStats();
+    showStats();
+}
+
+void FmtTool::writeResultTable()
+{
+    if (recordWriter_) {
+        out_.flush();  // Everything was written while formatting.
+        return;
+    }
+    if (stream_) {
+        // Everything was written while formatting.
+        out_.write("\n");
+        out_.flush();
+        return;
+    }
+
+    // first 2 rows are the title, then the underscore lines. They take on the final column widths of the table.
+    for (size_t col = 0; col < results_.getColumnCount(); ++col) {
+        titleRow1_[col].second = results_.getColumnWidth(col);
+        titleRow2_[col].second = results_.getColumnWidth(col);
+        underscoreRow_[col].second = results_.getColumnWidth(col);
     }
+    showRow(titleRow1_);
+    showRow(titleRow2_);
+    showUnderscoreRow(underscoreRow_);
 
-    std::cout << std::endl;
+    // The rows come a block at a time, which is all of them unless some were spilled to the temporary file (-maxmem)
+    results_.forEachBlock([this](const std::vector<FmtColumnData> &cols) {
+        size_t numRows = cols.empty() ? 0 : cols[0].size();
+        for (size_t row = 0; row < numRows; ++row) {
+            for (size_t col = 0; col < cols.size(); ++col) {
+                showCell(cols[col].getCell(row), results_.getColumnWidth(col));
+            }
+            out_.write("\n");
+        }
+    });
+
+    out_.write("\n");
+    out_.flush();
+}
+
+void FmtTool::flushOutput()
+{
+    out_.flush();
 }
@@ -2,21 +2,26 @@
 
 #include <iostream>
 #include <memory>
-#include <set>
+#include <memory_resource>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
+#include "fmt_cache.h"
+#include "fmt_formatter.h"
+#include "fmt_pipeline.h"
+#include "fmt_stats.h"
 #include "fmt_type.h"
+#include "input_tokenizer.h"
+#include "mapped_file.h"
+#include "output_writer.h"
+#include "record_writer.h"
+#include "result_table.h"
 
-// A template specialization for std::less so that std::set can work with unique ptr's but uses
-// the object itself for positioning and comparisons in the set.
-template<>
-struct std::less<std::unique_ptr<FmtType>> {
-    bool operator()(const std::unique_ptr<FmtType> &a, const std::unique_ptr<FmtType> &b) const {
-        return *a < *b;
-    }
-};
-
+// The fmttool command line program: parses the args, reads the user values from the command line, stdin or a file,
+// formats them with an FmtFormatter and writes the table. Programs that only want the formatting should use
+// FmtFormatter directly.
 class FmtTool {
 public:
     enum class CmdArg : int8_t {
@@ -25,34 +30,107 @@ public:
         ASCII = 3,
         BINARY = 4,
         SUPP_BIN = 5,
-        HELP = 6
+        HELP = 6,
+        STREAM = 7,
+        JOBS = 8,
+        FILE = 9,
+        SERVE = 10,
+        RAW = 11,
+        RAW_BE = 12,
+        RAW_LE = 13,
+        OUTPUT = 14,
+        CACHE = 15,
+        STATS = 16,
+        LINES = 17,
+        MAXMEM = 18
     };
 
     static const std::string DFT_ARGS;
-    FmtTool();
+    explicit FmtTool(int outFd = STDOUT_FILENO);  // table output goes to outFd
     ~FmtTool() = default;
+    // Each arg is one word of the command line, as is. A user value with spaces in it (quoted in the shell) stays one
+    // value.
+    void parseArgs(const std::vector<std::string> &args);
+    // The same, with the args split at white space
     void parseArgs(std::stringstream *argStream);
     bool showHelp();
+    bool serve();
+    bool formatFiles(bool &allFormatted);
     void addTitles();
     void executeFormatting();
     void displayResultTable();
-    bool IsBinaryFmtSuppressed() {
-        return noBin_;
-    }
+    void flushOutput();
 
 private:
     using FmtColList = std::vector<FmtType::FmtColumn>;  // the columns
-    using ResultTable = std::vector<FmtColList>;  // rows of columns
     static const int COL_SPACE;
-    void addToResultTable(const std::string &value);
-    void prepareTableForDisplay();
-    void showRow(ResultTable::const_iterator &resultsIter);
+    static const size_t BATCH_SIZE;
+    static const size_t MAX_JOBS;
+    static const size_t MAX_CACHE_ENTRIES;
+    bool isInputReady();
+    bool readBatch(FmtPipeline::InputBatch &input);
+    bool readTextBatch(FmtPipeline::InputBatch &input);
+    bool readRawBatch(FmtPipeline::InputBatch &input);
+    void formatBatch(size_t worker, const FmtPipeline::InputBatch &input, std::vector<FmtColumnData> &cols);
+    void formatValues(const std::string_view *values, const uint64_t *rawValues, size_t count, FmtColumnData *cols,
+                      FmtStats *stats, std::pmr::memory_resource *scratch) const;
+    void formatCachedValues(size_t worker, const FmtPipeline::InputBatch &input, std::vector<FmtColumnData> &cols,
+                            FmtStats *stats, std::pmr::memory_resource &arena);
+    void showCacheStats();
+    void showStats();
+    void writeResultTable();
+    void storeBatch(const std::vector<FmtColumnData> &cols);
+    void prepareStreamWidths(const FmtColList &titleRow);
+    void applyStreamWidths(FmtColList &row);
+    size_t getStreamWidth(size_t col, size_t dataWidth);
+    void showCell(std::string_view data, size_t width);
+    void showRow(const FmtColList &row);
+    void showUnderscoreRow(const FmtColList &row);
     std::unordered_map<std::string, CmdArg> cmdArgMap_;
-    std::set<std::unique_ptr<FmtType>> fmtTypes_;
-    std::unique_ptr<std::istringstream> iSStream_;
-    std::istream *inStream_;
+    FmtFormatter formatter_;                  // the format types. Their columns follow the input column.
+    std::vector<std::string> userValues_;     // the user values given on the command line, one per arg
+    size_t userPos_;                          // next of userValues_ to read
+    std::string inFileName_;                  // -f input file. Empty when reading the command line or stdin
+    std::vector<std::string> inFileNames_;    // every -f file. With more than one, see formatFiles().
+    std::vector<std::string> otherArgs_;      // the args without the -f files, for the FmtTool of each file
+    std::unique_ptr<MappedFile> mappedFile_;
+    std::unique_ptr<InputTokenizer> tokenizer_;  // text input from the mapped file or stdin. Null otherwise
+    bool lineMode_;                           // -l: each line of the text input is one value
+    size_t mapPos_;                           // -raw from the mapped file: position of the next record
+    size_t rawBits_;                          // -raw record size in bits. 0 when the input is text
+    bool rawBigEndian_;                       // -be: the raw records are big endian (the default is little endian)
+    std::vector<char> rawBuf_;                // -raw from stdin: bytes read but not yet used
+    size_t rawPos_;                           // first unused byte of rawBuf_
+    size_t rawLen_;                           // end of the bytes in rawBuf_
+    bool rawEof_;                             // -raw from stdin: no more bytes to read
+    std::string servePath_;                   // -serve socket path. Empty when not serving
     bool helpRequested_;
-    bool noBin_;
+    size_t cacheSize_;                  // -cache entries per formatting thread. 0 for no cache
+    std::vector<std::unique_ptr<FmtCache>> caches_;  // one per formatting thread, so they need no locking
+    // Per formatting thread buffers, reused from one batch to the next so formatting a batch doesn't allocate
+    struct WorkerScratch {
+        std::unique_ptr<char[]> arenaBuf;     // backs a new arena for each batch (see formatBatch())
+        size_t arenaSize = 0;
+        std::vector<FmtColumnData> missCols;  // -cache: the formatter's columns for the misses
+    };
+    std::vector<WorkerScratch> workerScratch_;
+    size_t maxMem_;                     // -maxmem: bytes of table rows kept in memory before spilling. 0 for no limit
+    bool showStats_;                    // -stats: report timings and counts on stderr at the end
+    // Stage timings are always kept (they are cheap). The per format type ones only with -stats. Each thread has its
+    // own: the reader, every formatting thread and the writer (which is the main thread).
+    FmtStats readStats_;
+    std::vector<FmtStats> workerStats_;
+    FmtStats writeStats_;
+    FmtStats::Clock::time_point startTime_;  // when executeFormatting() began
+    size_t numJobs_;                    // formatting threads. 1 formats on the main thread without a pipeline
+    bool stream_;                       // write each row as soon as it is formatted instead of buffering the table
+    std::vector<size_t> streamWidths_;  // stream mode only: current display width of each column
+    std::vector<bool> streamGrowCols_;  // stream mode only: columns with no upper bound, widened as data arrives
+    FmtColList titleRow1_;
+    FmtColList titleRow2_;
+    FmtColList underscoreRow_;
     ResultTable results_;
+    OutputWriter out_;  // all table output goes through here (not std::cout)
+    std::unique_ptr<RecordWriter> recordWriter_;  // -o csv|tsv|jsonl. Null for the table output
 };
 
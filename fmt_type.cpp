@@ -1,12 +1,19 @@
 #include "fmt_type.h"
 #include <string>
 #include "fmt_exception.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
 
 const std::string FmtType::OUT_OF_RANGE = "<out_of_range>";
 const std::string FmtType::INVALID = "<invalid>";
 
 // Base methods
-FmtType::FmtType(FmtTool *parent) : parentTool_(parent)
+FmtType::FmtType(const FmtFormatter *parent) : parentFormatter_(parent)
 {
 }
+
+FmtType::ResultCounts FmtType::formatRawBatch(const uint64_t * /*rawValues*/, const std::string_view *values,
+                                              size_t count, size_t /*rawBits*/, FmtColumnData *cols,
+                                              std::pmr::memory_resource * /*scratch*/) const
+{
+    return formatBatch(values, count, cols);
+}
@@ -2,11 +2,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <typeinfo>
 #include <vector>
+#include "fmt_column.h"
 
-class FmtTool;
+class FmtFormatter;
 
 class FmtType {
 public:
@@ -14,7 +17,20 @@ public:
     // the size of the data itself for column alignment.
     using FmtColumn = std::pair<std::string, size_t>;
 
-    FmtType(FmtTool *parent);
+    // How many values of a batch failed, by error. The rest are valid. The batch functions count them as they go, so
+    // -stats gets its result counts without looking at the cells again.
+    struct ResultCounts {
+        uint64_t outOfRange = 0;
+        uint64_t invalid = 0;
+    };
+
+    // A batch formatting function bound directly to one concrete type (and for IntType, one width and signedness).
+    // Calling it formats the values with the given FmtType object without a virtual call or any per-batch checks of
+    // the type's settings. See getFormatBatchFn().
+    using FormatBatchFn = ResultCounts (*)(const FmtType &fmtType, const std::string_view *values, size_t count,
+                                           FmtColumnData *cols);
+
+    FmtType(const FmtFormatter *parent);
     virtual ~FmtType() = default;
 
     // For use with std::set comparison and duplicate elimination
@@ -26,12 +42,38 @@ public:
         return typeid(*this).hash_code() < typeid(other).hash_code();
     }
     virtual std::string toString() const = 0;
-    virtual void format(std::vector<FmtType::FmtColumn> &formattedCols, const std::string &value) = 0;
+
+    // Formats a whole batch of values at once. Each of this type's output columns gets one cell per value appended,
+    // in the same order as the values. cols points at the first of this type's columns, and there are
+    // getColumnCount() of them.
+    // Working a column at a time lets the per-call setup be paid once per batch and gives the rendering loops long
+    // runs of the same kind of work.
+    // Returns how many of the values failed.
+    virtual ResultCounts formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const = 0;
+    // Formats a batch of fixed size binary records (the -raw input). rawValues holds each record as a number (zero
+    // extended from rawBits) and values holds the same records as text: "0x" and the hex digits of the record, which
+    // is what the input column shows. The result must be the same as formatting that text. The default does exactly
+    // that. Types that can use the number as is override it and skip the parse.
+    // Any buffers that are only needed during the call come from scratch, which the caller resets between batches.
+    virtual ResultCounts formatRawBatch(const uint64_t *rawValues, const std::string_view *values, size_t count,
+                                        size_t rawBits, FmtColumnData *cols,
+                                        std::pmr::memory_resource *scratch) const;
+    // Returns the function that does the same work as formatBatch() for this object. The choice of function is made
+    // here once, so the format plan can call it for every batch without going through the virtual formatBatch().
+    virtual FormatBatchFn getFormatBatchFn() const = 0;
+    // Number of output columns this type produces (the same as the number of title columns).
+    virtual size_t getColumnCount() const = 0;
     virtual size_t getCompareHash() const = 0;
     virtual void getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
                              std::vector<FmtType::FmtColumn> &underscoreRow) const = 0;
-protected:
+    // Appends the largest display width that each column of this type can ever produce, one entry per column in the
+    // same order as formatBatch(). A width of 0 means the column is unbounded (depends on the length of the input).
+    // Used by the streaming mode which must pick column widths before it has seen any data.
+    virtual void getColumnWidths(std::vector<size_t> &maxWidths) const = 0;
+
+    // The cell text of a value that a type can't format. Public so that results can be counted (see FmtStats).
     static const std::string OUT_OF_RANGE;
     static const std::string INVALID;
-    FmtTool *parentTool_;  // a back pointer to the main tool class.
+protected:
+    const FmtFormatter *parentFormatter_;  // a back pointer to the formatter that owns this type (for its settings)
 };
@@ -0,0 +1,160 @@
+#include "input_tokenizer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include "fmt_exception.h"
+#include "fmt_kernels.h"
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');  // same as FmtKernels::findSpace()
+}
+
+InputTokenizer::InputTokenizer(std::string_view data, Mode mode) : mode_(mode), fd_(-1), data_(data), pos_(0),
+                                                                   scanned_(0), eof_(true)
+{
+}
+
+InputTokenizer::InputTokenizer(int fd, Mode mode) : mode_(mode), fd_(fd), pos_(0), scanned_(0), eof_(false)
+{
+}
+
+bool InputTokenizer::readBatch(std::vector<std::string_view> &values, size_t maxCount, std::vector<char> &buf)
+{
+    values.clear();
+    std::string_view value;
+    if (fd_ < 0) {
+        while (values.size() < maxCount && nextValue(data_.data(), data_.size(), pos_, true, value)) {
+            values.push_back(value);
+        }
+        return values.size() == maxCount;
+    }
+
+    // Start with what was left over from last time. That is usually the start of a value that was cut off at the end
+    // of the last read, and sometimes values that didn't fit in the last batch.
+    buf.assign(carry_.begin(), carry_.end());
+    size_t pos = 0;
+    while (values.size() < maxCount) {
+        if (nextValue(buf.data(), buf.size(), pos, eof_, value)) {
+            values.push_back(value);
+            continue;
+        }
+        if (eof_) {
+            break;
+        }
+        // Out of whole values. Don't sit on the ones we have if the next read would block: on a live pipe they should
+        // go out now rather than after the next burst of input.
+        pollfd inPoll = {fd_, POLLIN, 0};
+        if (!values.empty() && poll(&inPoll, 1, 0) <= 0) {
+            break;
+        }
+        readMore(buf, values);
+    }
+    carry_.assign(buf.begin() + pos, buf.end());
+    return !(eof_ && carry_.empty());
+}
+
+bool InputTokenizer::isInputReady()
+{
+    if (fd_ < 0 || eof_) {
+        return true;  // nothing to wait for
+    }
+    size_t pos = 0;
+    std::string_view value;
+    if (nextValue(carry_.data(), carry_.size(), pos, false, value)) {
+        return true;
+    }
+    pollfd inPoll = {fd_, POLLIN, 0};
+    return poll(&inPoll, 1, 0) > 0;
+}
+
+void InputTokenizer::split(std::string_view data, Mode mode, std::vector<std::string_view> &values)
+{
+    InputTokenizer tokenizer(data, mode);
+    size_t pos = 0;
+    std::string_view value;
+    while (tokenizer.nextValue(data.data(), data.size(), pos, true, value)) {
+        values.push_back(value);
+    }
+}
+
+bool InputTokenizer::nextValue(const char *data, size_t len, size_t &pos, bool atEnd, std::string_view &value)
+{
+    // A value that was cut off last time starts at pos, and its first scanned_ characters are already known to hold no
+    // end. The scan picks up after them, so a long value is scanned once however many reads it takes to arrive.
+    if (mode_ == Mode::TOKENS) {
+        // Values are mostly split by a single white space character, which is checked here before calling the kernel
+        // for any more.
+        if (pos < len && isSpace(data[pos])) {
+            ++pos;
+            if (pos < len && isSpace(data[pos])) {
+                pos += FmtKernels::skipSpace(data + pos, len - pos);
+            }
+        }
+        if (pos == len) {
+            return false;
+        }
+        size_t scanFrom = pos + scanned_;
+        size_t end = scanFrom + FmtKernels::findSpace(data + scanFrom, len - scanFrom);
+        if (end == len && !atEnd) {
+            scanned_ = len - pos;
+            return false;  // the value might go on in the text that hasn't been read yet
+        }
+        scanned_ = 0;
+        value = std::string_view(data + pos, end - pos);
+        pos = end;
+        return true;
+    }
+
+    while (pos < len) {
+        size_t scanFrom = pos + scanned_;
+        const char *lineEnd = static_cast<const char *>(std::memchr(data + scanFrom, '\n', len - scanFrom));
+        if (lineEnd == nullptr && !atEnd) {
+            scanned_ = len - pos;
+            return false;
+        }
+        scanned_ = 0;
+        size_t start = pos;
+        size_t end = (lineEnd != nullptr) ? lineEnd - data : len;
+        pos = (lineEnd != nullptr) ? end + 1 : len;
+        if (end > start && data[end - 1] == '\r') {
+            --end;  // a \r\n line end
+        }
+        if (end > start) {
+            value = std::string_view(data + start, end - start);
+            return true;
+        }
+    }
+    return false;
+}
+
+void InputTokenizer::readMore(std::vector<char> &buf, std::vector<std::string_view> &values)
+{
+    size_t len = buf.size();
+    if (len + READ_SIZE > buf.capacity()) {
+        // Grow by hand so the values can be moved over to the new memory before the old is freed.
+        std::vector<char> bigger;
+        bigger.reserve(std::max(buf.capacity() * 2, len + READ_SIZE));
+        bigger.assign(buf.begin(), buf.end());
+        for (auto &value : values) {
+            value = std::string_view(bigger.data() + (value.data() - buf.data()), value.size());
+        }
+        buf.swap(bigger);
+    }
+    buf.resize(len + READ_SIZE);
+    ssize_t numRead;
+    do {
+        numRead = read(fd_, buf.data() + len, READ_SIZE);
+    } while (numRead < 0 && errno == EINTR);
+    if (numRead < 0) {
+        buf.resize(len);
+        THROW_FMT_EXCEPTION(std::string("Input stream error: ") + std::strerror(errno));
+    }
+    buf.resize(len + static_cast<size_t>(numRead));
+    if (numRead == 0) {
+        eof_ = true;
+    }
+}
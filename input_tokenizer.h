@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Splits input text into the values to format: either white space separated tokens, or whole lines (-l) so that a
+// value can hold spaces. The text is either already in memory (a mapped -f file, a server request), in which case the
+// values point right into it, or it is read from a file descriptor (stdin) in large chunks.
+// The scanning is done with the white space kernels (see FmtKernels::findSpace()) and memchr, so there is nothing per
+// value but the scan itself: no stream, no per value string and no copying.
+class InputTokenizer {
+public:
+    enum class Mode : uint8_t {
+        TOKENS,  // runs of non white space characters
+        LINES    // each line is one value, as is (only the line end is dropped). Empty lines are skipped.
+    };
+
+    // Over text that stays in memory for as long as its values are used
+    InputTokenizer(std::string_view data, Mode mode);
+    // Reading from fd, which stays open and is not closed here
+    InputTokenizer(int fd, Mode mode);
+    ~InputTokenizer() = default;
+    InputTokenizer(const InputTokenizer &) = delete;
+    InputTokenizer &operator=(const InputTokenizer &) = delete;
+
+    // Replaces values with the next values of the input, at most maxCount of them. Returns false at the end of the
+    // input, in which case values holds whatever was left (maybe nothing).
+    // When reading from an fd, the values point into buf, which is the caller's to keep along with them. Each call
+    // reads into the buf it is given, so one buf per batch in flight lets the values of one batch stay in use while
+    // the next is read. The buf keeps its capacity from one call to the next. It is not used for in memory text.
+    // From an fd, this stops short of maxCount (but not short of one value) rather than wait on the input.
+    bool readBatch(std::vector<std::string_view> &values, size_t maxCount, std::vector<char> &buf);
+
+    // True if the next value can be read without waiting on the input
+    bool isInputReady();
+
+    // All of the values of data at once, appended to values
+    static void split(std::string_view data, Mode mode, std::vector<std::string_view> &values);
+
+private:
+    // stdin is read this much at a time. The buf grows past this for a value that is longer.
+    static const size_t READ_SIZE = 64 * 1024;
+
+    // Finds the next value in [pos, len) of data and moves pos past it. Returns false if there is no complete value.
+    // In that case pos is left at the start of what might become one once more text follows (unless atEnd, when no
+    // more will). How much of that was already scanned is kept in scanned_ for the next call.
+    bool nextValue(const char *data, size_t len, size_t &pos, bool atEnd, std::string_view &value);
+
+    // Reads more of the fd onto the end of buf, growing it as needed. values pointing into buf are moved along with it.
+    void readMore(std::vector<char> &buf, std::vector<std::string_view> &values);
+
+    Mode mode_;
+    int fd_;                  // -1 for in memory text
+    std::string_view data_;   // in memory text
+    size_t pos_;              // in memory text: where the next value starts looking
+    std::vector<char> carry_; // fd: text read but not yet handed out, carried over to the next readBatch()'s buf
+    size_t scanned_;          // fd: characters of the cut off value at the start of carry_ already scanned for its end
+    bool eof_;                // fd: nothing more to read
+};
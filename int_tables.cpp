@@ -0,0 +1,32 @@
+#include "int_tables.h"
+#include <charconv>
+
+template <typename T>
+static void fillDecEntry(IntTables::DecEntry &entry, T value)
+{
+    std::memset(&entry, 0, sizeof(entry));
+    char *end = std::to_chars(entry.text, entry.text + sizeof(entry.text), value).ptr;
+    entry.len = static_cast<uint8_t>(end - entry.text);
+}
+
+const IntTables &IntTables::get()
+{
+    static const IntTables tables;  // thread safe, the first caller builds it
+    return tables;
+}
+
+IntTables::IntTables()
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (size_t i = 0; i < NUM_VALUES; ++i) {
+        fillDecEntry(signedDec_[i], static_cast<int16_t>(i));
+        fillDecEntry(unsignedDec_[i], static_cast<uint16_t>(i));
+    }
+    for (size_t byte = 0; byte < 256; ++byte) {
+        hex_[byte][0] = HEX_DIGITS[byte >> 4];
+        hex_[byte][1] = HEX_DIGITS[byte & 0xf];
+        for (size_t bit = 0; bit < 8; ++bit) {
+            bin_[byte][bit] = ((byte >> (7 - bit)) & 1) ? '1' : '0';
+        }
+    }
+}
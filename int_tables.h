@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Precomputed text for the 8 and 16-bit int types. There are only 256 or 65536 values, so rather than render each one
+// the decimal of every 16-bit value (signed and unsigned) is kept in a table, and so are the hex digits and the binary
+// of every byte. A value is then a range check and a copy or two. The 8-bit types use the same tables: an int8_t is
+// looked up as the int16_t of the same value.
+// The tables are about 1MB, built the first time they are asked for, by whichever thread gets there first.
+class IntTables {
+public:
+    // One decimal string, sign included, left aligned and padded, with its length in the last byte. An entry is 8
+    // bytes so that it can be copied with a single load and store.
+    struct DecEntry {
+        char text[7];
+        uint8_t len;
+    };
+
+    static const IntTables &get();
+
+    const DecEntry &getDec(int16_t value) const
+    {
+        return signedDec_[static_cast<uint16_t>(value)];
+    }
+
+    const DecEntry &getDec(uint16_t value) const
+    {
+        return unsignedDec_[value];
+    }
+
+    const DecEntry &getDec(int8_t value) const
+    {
+        return getDec(static_cast<int16_t>(value));
+    }
+
+    const DecEntry &getDec(uint8_t value) const
+    {
+        return getDec(static_cast<uint16_t>(value));
+    }
+
+    // Writes the decimal of value to dst and returns its length. dst must have room for a whole DecEntry (8 bytes),
+    // even though only the length is meaningful.
+    template <typename T>
+    size_t writeDec(char *dst, T value) const
+    {
+        const DecEntry &entry = getDec(value);
+        std::memcpy(dst, &entry, sizeof(entry));
+        return entry.len;
+    }
+
+    // The same as FmtKernels::writeHex() and FmtKernels::writeBin(), for numBytes of 1 or 2
+    void writeHex(char *dst, uint16_t value, size_t numBytes) const
+    {
+        if (numBytes == 2) {
+            std::memcpy(dst, hex_[value >> 8], 2);
+            dst += 2;
+        }
+        std::memcpy(dst, hex_[value & 0xff], 2);
+    }
+
+    void writeBin(char *dst, uint16_t value, size_t numBytes) const
+    {
+        if (numBytes == 2) {
+            std::memcpy(dst, bin_[value >> 8], 8);
+            dst += 8;
+        }
+        std::memcpy(dst, bin_[value & 0xff], 8);
+    }
+
+private:
+    static const size_t NUM_VALUES = 65536;
+
+    IntTables();
+    IntTables(const IntTables &) = delete;
+    IntTables &operator=(const IntTables &) = delete;
+
+    DecEntry signedDec_[NUM_VALUES];    // indexed by the bits of the int16_t
+    DecEntry unsignedDec_[NUM_VALUES];
+    char hex_[256][2];
+    char bin_[256][8];
+};
@@ -1,15 +1,16 @@
 #include "int_type.h"
+#include <algorithm>
+#include <cctype>
 #include <climits>
-#include <iomanip>
 #include <limits>
-#include <sstream>
 #include <string>
 #include "fmt_exception.h"
 #include "fmt_type.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
 
 // IntType methods
-IntType::IntType(size_t width, bool isSigned, FmtTool *parent) : FmtType(parent), width_(width), isSigned_(isSigned)
+IntType::IntType(size_t width, bool isSigned, const FmtFormatter *parent)
+    : FmtType(parent), width_(width), isSigned_(isSigned)
 {
     if (width_ != 8 && width != 16 && width_ != 32 && width_ != 64) {
         THROW_FMT_EXCEPTION("Invalid width value for integer format (-i <width>). Must be 8, 16, 32, or 64.");
@@ -45,47 +46,101 @@ std::string IntType::toString() const
     return retStr;
 }
 
-void IntType::format(std::vector<FmtColumn> &formattedCols, const std::string &value)
+FmtType::ResultCounts IntType::formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const
 {
+    return getFormatBatchFn()(*this, values, count, cols);
+}
+
+FmtType::ResultCounts IntType::formatRawBatch(const uint64_t *rawValues, const std::string_view * /*values*/,
+                                              size_t count, size_t rawBits, FmtColumnData *cols,
+                                              std::pmr::memory_resource *scratch) const
+{
+    // The text isn't needed, the record already is the number.
     switch(width_) {
         case 8: {
-            if (isSigned_) {
-                format<int8_t, int>(formattedCols, value);
-            } else {
-                format<uint8_t, int>(formattedCols, value);
-            }
-            break;
+            return (isSigned_) ? formatRawBatch<int8_t>(rawValues, count, rawBits, cols, scratch)
+                               : formatRawBatch<uint8_t>(rawValues, count, rawBits, cols, scratch);
         }
         case 16: {
-            if (isSigned_) {
-                format<int16_t, int>(formattedCols, value);
-            } else {
-                format<uint16_t, int>(formattedCols, value);
-            }
-            break;
+            return (isSigned_) ? formatRawBatch<int16_t>(rawValues, count, rawBits, cols, scratch)
+                               : formatRawBatch<uint16_t>(rawValues, count, rawBits, cols, scratch);
         }
         case 32: {
-            if (isSigned_) {
-                format<int32_t, long int>(formattedCols, value);
-            } else {
-                format<uint32_t, long int>(formattedCols, value);
-            }
+            return (isSigned_) ? formatRawBatch<int32_t>(rawValues, count, rawBits, cols, scratch)
+                               : formatRawBatch<uint32_t>(rawValues, count, rawBits, cols, scratch);
+        }
+        case 64: {
+            return (isSigned_) ? formatRawBatch<int64_t>(rawValues, count, rawBits, cols, scratch)
+                               : formatRawBatch<uint64_t>(rawValues, count, rawBits, cols, scratch);
+        }
+        default: {
+            // not possible because we already checked this. but leave the check here anyway.
+            THROW_FMT_EXCEPTION("Invalid width value for integer format (-i <width>). Must be 8, 16, 32, or 64.");
             break;
         }
+    }
+    return ResultCounts();
+}
+
+FmtType::FormatBatchFn IntType::getFormatBatchFn() const
+{
+    // Pick the template instance for the width and signedness. This is the only place the width is looked at, so the
+    // format plan doesn't have to do it again for every batch.
+    switch(width_) {
+        case 8: {
+            return (isSigned_) ? &IntType::formatBatchFn<int8_t, int> : &IntType::formatBatchFn<uint8_t, int>;
+        }
+        case 16: {
+            return (isSigned_) ? &IntType::formatBatchFn<int16_t, int> : &IntType::formatBatchFn<uint16_t, int>;
+        }
+        case 32: {
+            return (isSigned_) ? &IntType::formatBatchFn<int32_t, long int>
+                               : &IntType::formatBatchFn<uint32_t, long int>;
+        }
         case 64: {
-            if (isSigned_) {
-                format<int64_t, long long int>(formattedCols, value);
-            } else {
-                format<uint64_t, unsigned long long int>(formattedCols, value);
-            }
+            return (isSigned_) ? &IntType::formatBatchFn<int64_t, long long int>
+                               : &IntType::formatBatchFn<uint64_t, unsigned long long int>;
+        }
+        default: {
+            // not possible because we already checked this. but leave the check here anyway.
+            THROW_FMT_EXCEPTION("Invalid width value for integer format (-i <width>). Must be 8, 16, 32, or 64.");
             break;
         }
+    }
+    return nullptr;
+}
+
+FmtType::ResultCounts IntType::formatParsedBatch(const ParsedInt *parsed, size_t count, FmtColumnData *cols,
+                                                 std::pmr::memory_resource *scratch) const
+{
+    return getFormatParsedFn()(*this, parsed, count, cols, scratch);
+}
+
+IntType::FormatParsedFn IntType::getFormatParsedFn() const
+{
+    // Same choice as getFormatBatchFn(), for the batch version that starts from parsed values
+    switch(width_) {
+        case 8: {
+            return (isSigned_) ? &IntType::formatParsedFn<int8_t, int> : &IntType::formatParsedFn<uint8_t, int>;
+        }
+        case 16: {
+            return (isSigned_) ? &IntType::formatParsedFn<int16_t, int> : &IntType::formatParsedFn<uint16_t, int>;
+        }
+        case 32: {
+            return (isSigned_) ? &IntType::formatParsedFn<int32_t, long int>
+                               : &IntType::formatParsedFn<uint32_t, long int>;
+        }
+        case 64: {
+            return (isSigned_) ? &IntType::formatParsedFn<int64_t, long long int>
+                               : &IntType::formatParsedFn<uint64_t, unsigned long long int>;
+        }
         default: {
             // not possible because we already checked this. but leave the check here anyway.
             THROW_FMT_EXCEPTION("Invalid width value for integer format (-i <width>). Must be 8, 16, 32, or 64.");
             break;
         }
     }
+    return nullptr;
 }
 
 void IntType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
@@ -105,7 +160,7 @@ void IntType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vecto
     titleRow1.emplace_back(BASE_16, BASE_16.size());
     titleRow2.emplace_back(widthName, widthName.size());
     underscoreRow.emplace_back("", BASE_16.size());
-    if (!parentTool_->IsBinaryFmtSuppressed()) {
+    if (!parentFormatter_->IsBinaryFmtSuppressed()) {
         // display binary formatting column if it has not been univesally suppressed via flag
         titleRow1.emplace_back(BASE_2, BASE_2.size());
         titleRow2.emplace_back(widthName, widthName.size());
@@ -114,155 +169,151 @@ void IntType::getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vecto
 
 }
 
-// specialization for int8_t. The general method for converting to hex doesnt' work for this one.
-// cast the single byte to int32_t first.
-template <>
-void IntType::fmtNumToHex<int8_t>(std::vector<FmtType::FmtColumn> &formattedCols, int8_t valueAsType)
+void IntType::getColumnWidths(std::vector<size_t> &maxWidths) const
 {
-    std::stringstream ss;
-    // For negative numbers, casting to 4 byte type adds lots of 0xFF's. But there's only one byte
-    // here.  Thus, we need to truncate
-    ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int32_t>(valueAsType);
-    std::string formattedData = ss.str();
-    int strSize = formattedData.size();
-    if (strSize > 2) {
-        formattedData = formattedData.substr(strSize - 2, strSize);
+    // Every column can hold one of the error strings, so those set the minimum.
+    size_t errWidth = std::max(OUT_OF_RANGE.size(), INVALID.size());
+
+    // Base 10: the widest number is the min value for signed types (it has the '-') or the max value for unsigned.
+    // Computing it from the string of the limit is simpler than keeping a table of digit counts.
+    size_t decWidth = 0;
+    switch (width_) {
+        case 8: {
+            decWidth = (isSigned_) ? std::to_string(std::numeric_limits<int8_t>::min()).size()
+                                   : std::to_string(std::numeric_limits<uint8_t>::max()).size();
+            break;
+        }
+        case 16: {
+            decWidth = (isSigned_) ? std::to_string(std::numeric_limits<int16_t>::min()).size()
+                                   : std::to_string(std::numeric_limits<uint16_t>::max()).size();
+            break;
+        }
+        case 32: {
+            decWidth = (isSigned_) ? std::to_string(std::numeric_limits<int32_t>::min()).size()
+                                   : std::to_string(std::numeric_limits<uint32_t>::max()).size();
+            break;
+        }
+        case 64: {
+            decWidth = (isSigned_) ? std::to_string(std::numeric_limits<int64_t>::min()).size()
+                                   : std::to_string(std::numeric_limits<uint64_t>::max()).size();
+            break;
+        }
+        default: {
+            // not possible because we already checked this. but leave the check here anyway.
+            THROW_FMT_EXCEPTION("Invalid width value for integer format (-i <width>). Must be 8, 16, 32, or 64.");
+            break;
+        }
     }
-    formattedData = "0x" + formattedData;
-    formattedCols.emplace_back(formattedData, formattedData.size());
-}
+    maxWidths.push_back(std::max(decWidth, errWidth));
 
-// specialization for uint8_t. The general method for converting to hex doesnt' work for this one.
-// cast the single byte to uint32_t first.
-template <>
-void IntType::fmtNumToHex<uint8_t>(std::vector<FmtType::FmtColumn> &formattedCols, uint8_t valueAsType)
-{
-    std::stringstream ss;
-    ss << std::hex << "0x" << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(valueAsType);
-    std::string formattedData = ss.str();
-    formattedCols.emplace_back(formattedData, formattedData.size());
+    // Hex: 2 characters per byte plus the "0x" prefix
+    maxWidths.push_back(std::max(width_ / 4 + 2, errWidth));
+
+    // Bin: 1 character per bit
+    if (!parentFormatter_->IsBinaryFmtSuppressed()) {
+        maxWidths.push_back(std::max(width_, errWidth));
+    }
 }
 
 // A note on the formatting:
-// std::stoi has the ability to read the negative sign, as well as 0x prefix to convert string hex intputs. The 3rd arg
-// is the "base". Special value of 0 means it will try to auto-detect. For example, if the input is 0x12 it will format
-// as base 16 (hex). If 012 it assumes octal etc. Otherwise it assume base 10.
+// The parsing follows the same rules that std::stoi(value, nullptr, 0) has always used here: leading white space is
+// skipped, then an optional '+' or '-' sign. The base is auto-detected. If the input is 0x12 it is parsed as base 16
+// (hex). If 012 it assumes octal. Otherwise it assumes base 10. Parsing stops at the first character that is not a
+// digit of the base, so "12abc" is the number 12.
 // What happens if the value is too large for the defined type, or other invalid values?
-// Exceptions:
-// std::invalid_argument if no conversion could be performed
-// std::out_of_range if the converted value would fall out of the range of the result type or if the underlying
-// function sets errno to ERANGE.
-// Lastly, in most cases we'll use the non-unsigned versions of the call, but will ensure to use a larger bitwidth of
-// the std::sto* functions.  For example, for 8, 16 bit, we can use the 32-bit std::stoi.  For 32, we'll use long int.
-// The only challenge is the uint64_t conversion.  There is not larger type.  We can safely use std::stoll for the
-// int64_t, but for uin64_t we need one more bit. This requries std::stoull function.  However, this function deploys
-// integer wrapping. -1 does not yield out of range error naturally.  it just wraps it to the max postive value.
-// Thus, manual detection of negative will be added for that case.
+// FmtErrInvalid if no digits could be parsed at all.
+// FmtErrRange if the magnitude doesn't fit in 64 bits, or later if the value falls out of the range of the type.
+// This used to be done with the std::sto* functions and catching their std::invalid_argument and std::out_of_range
+// exceptions. When most of the input is junk, the exception unwinding cost far more than the parsing itself, so we
+// now parse by hand and hand back the error code directly. A bad token costs the same as a good one.
+// Lastly, the magnitude is kept in 64 bits and the sign applied in 128, so the one parse has room for every width.
+// The range checks for each width are done afterwards, see parseValue() in int_type.tpp.
 
-template <>
-int IntType::stringToNum<int>(const std::string &value, ErrType &err)
+IntType::ErrType IntType::parseMagnitude(std::string_view value, bool &isNegative,
+                                          unsigned long long &magnitude)
 {
-    int intValue;
-    try {
-        intValue = std::stoi(value, nullptr, 0);
-    }
-    catch (std::invalid_argument const& ex)
-    {
-        err = ErrType::FmtErrInvalid;
+    size_t pos = 0;
+    size_t len = value.size();
+    isNegative = false;
+    magnitude = 0;
+
+    while (pos < len && std::isspace(static_cast<unsigned char>(value[pos]))) {
+        ++pos;
     }
-    catch(std::out_of_range const& ex)
-    {
-        // Don't throw an exception if we are out of range. Instead, we'll print a message in the formatted output.
-        err = ErrType::FmtErrRange;
+    if (pos < len && (value[pos] == '+' || value[pos] == '-')) {
+        isNegative = (value[pos] == '-');
+        ++pos;
     }
-    return intValue;
-}
 
-template <>
-long int IntType::stringToNum<long int>(const std::string &value, ErrType &err)
-{
-    long int intValue;
-    try {
-        intValue = std::stol(value, nullptr, 0);
+    // Base detection. A "0x" only counts as a hex prefix if a hex digit follows it. Otherwise the '0' is the whole
+    // number (same as strtol).
+    unsigned int base = 10;
+    if (pos < len && value[pos] == '0') {
+        if (pos + 2 < len && (value[pos + 1] == 'x' || value[pos + 1] == 'X') &&
+            std::isxdigit(static_cast<unsigned char>(value[pos + 2]))) {
+            base = 16;
+            pos += 2;
+        } else {
+            base = 8;
+        }
     }
-    catch (std::invalid_argument const& ex)
-    {
-        err = ErrType::FmtErrInvalid;
+
+    // Accumulate the digits. On overflow we keep consuming digits (they're still part of the number) but remember
+    // that the result can't be represented.
+    const unsigned long long maxValue = std::numeric_limits<unsigned long long>::max();
+    bool overflow = false;
+    size_t digitStart = pos;
+    while (pos < len) {
+        char c = value[pos];
+        unsigned int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            break;
+        }
+        if (digit >= base) {
+            break;
+        }
+        if (magnitude > (maxValue - digit) / base) {
+            overflow = true;
+        } else {
+            magnitude = magnitude * base + digit;
+        }
+        ++pos;
     }
-    catch(std::out_of_range const& ex)
-    {
-        // Don't throw an exception if we are out of range. Instead, we'll print a message in the formatted output.
-        err = ErrType::FmtErrRange;
+
+    if (pos == digitStart) {
+        return ErrType::FmtErrInvalid;
     }
-    return intValue;
+    return (overflow) ? ErrType::FmtErrRange : ErrType::FmtErrNone;
 }
 
-template <>
-long long int IntType::stringToNum<long long int>(const std::string &value, ErrType &err)
+void IntType::parseInt(std::string_view value, ParsedInt &parsed)
 {
-    long long int intValue;
-    try {
-        intValue = std::stoll(value, nullptr, 0);
+    bool isNegative;
+    unsigned long long magnitude;
+    parsed.err = parseMagnitude(value, isNegative, magnitude);
+    parsed.value = 0;
+    if (parsed.err == ErrType::FmtErrNone) {
+        parsed.value = (isNegative) ? -static_cast<__int128>(magnitude) : static_cast<__int128>(magnitude);
     }
-    catch (std::invalid_argument const& ex)
-    {
-        err = ErrType::FmtErrInvalid;
-    }
-    catch(std::out_of_range const& ex)
-    {
-        // Special case for a hex number
-        // When you read in a hex number, it treats the number as the numerical value itself, not the internal bit
-        // representation of it.
-        // For example, the number 0x8000000000000000 will be assumed to be huge positive number that is too big for the
-        // 64-bit in type, so it gives out of range exeception.
-        // The problem with this is that this same hex number IS a valid number for 64-bit int. Its the number
-        // -9223372036854775808 which is in range.
-        // We can use stoull though.  This will allow it, and then cast the number into its signed type.
-        // I didn't bother to implmenet this logic for the other signed type conversions because there was always a
-        // "bigger bitwidth" that we could use. no such luck for 64-bit dudes.  There isn't a 128 bit numeric native
-        // type.
-        if (value.compare(0,2, "0x") == 0) {
-            try {
-                unsigned long long int tempValue;
-                tempValue = std::stoull(value, nullptr, 0);
-                intValue = tempValue;  // purposely down cast.  will change the value to correct negative value
-            }
-            catch (std::invalid_argument const& ex)
-            {
-                err = ErrType::FmtErrInvalid;
-            }
-            catch(std::out_of_range const& ex)
-            {
-                err = ErrType::FmtErrRange;
-            }
-        } else {
-            // Don't throw an exception if we are out of range. Instead, we'll print a message in the formatted output.
-            err = ErrType::FmtErrRange;
-        }
+
+    // How it was written. The exact width rule goes by the length of the token, the same as it always has.
+    parsed.hexPrefix = (value.size() >= 2 && value[0] == '0' && value[1] == 'x');
+    parsed.hexBytes = 0;
+    if (parsed.hexPrefix && value.size() > 2 && value[2] != '0' && (value.size() - 2) / 2 <= sizeof(uint64_t)) {
+        parsed.hexBytes = static_cast<uint8_t>((value.size() - 2) / 2);
     }
-    return intValue;
+    parsed.leadingMinus = (!value.empty() && value[0] == '-');
 }
 
-template <>
-unsigned long long int IntType::stringToNum<unsigned long long int>(const std::string &value, ErrType &err)
+void IntType::parseBatch(const std::string_view *values, size_t count, ParsedInt *parsed)
 {
-    long long int intValue;
-    // Manual detection of a negative input. Treat this as out of range rather than format the overlap.
-    if (value[0] == '-') {
-        err = ErrType::FmtErrRange;
-        return 0;
-    }
-    try {
-        intValue = std::stoull(value, nullptr, 0);
-    }
-    catch (std::invalid_argument const& ex)
-    {
-        err = ErrType::FmtErrInvalid;
-    }
-    catch(std::out_of_range const& ex)
-    {
-        // Don't throw an exception if we are out of range. Instead, we'll print a message in the formatted output.
-        err = ErrType::FmtErrRange;
+    for (size_t i = 0; i < count; ++i) {
+        parseInt(values[i], parsed[i]);
     }
-    return intValue;
 }
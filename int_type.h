@@ -1,47 +1,146 @@
 #pragma once
 
-#include <bitset>
+#include <algorithm>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <typeinfo>
 #include <vector>
 #include "fmt_exception.h"
+#include "fmt_kernels.h"
 #include "fmt_type.h"
-#include "fmt_tool.h"
+#include "fmt_formatter.h"
+#include "int_tables.h"
 
-//class FmtTool;
+//class FmtFormatter;
 
 class IntType : public FmtType {
 public:
-    IntType(size_t width, bool isSigned, FmtTool *parent);
+    enum class ErrType : uint8_t {FmtErrNone = 0, FmtErrRange = 1, FmtErrInvalid = 2};
+
+    // A token parsed once, for all of the int widths. The value is wide enough to hold any magnitude up to 64 bits
+    // with its sign applied, so each width only has to range check it (see parseValue()). The other fields keep what
+    // the hex-negative rule and the unsigned parse need to know about how the number was written.
+    struct ParsedInt {
+        __int128 value;
+        ErrType err;         // FmtErrInvalid (no digits) or FmtErrRange (more than 64 bits). value is 0 for both.
+        uint8_t hexBytes;    // written as 0x with a non-zero first digit: bytes in the source digits, else 0
+        bool hexPrefix;      // the token starts with 0x
+        bool leadingMinus;   // the token starts with '-' (no white space before it)
+    };
+
+    IntType(size_t width, bool isSigned, const FmtFormatter *parent);
     ~IntType() = default;
     std::string toString() const override;
-    void format(std::vector<FmtType::FmtColumn> &formattedCols, const std::string &value) override;
+    ResultCounts formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const override;
+    ResultCounts formatRawBatch(const uint64_t *rawValues, const std::string_view *values, size_t count,
+                                size_t rawBits, FmtColumnData *cols, std::pmr::memory_resource *scratch) const override;
+    FormatBatchFn getFormatBatchFn() const override;
+    size_t getColumnCount() const override
+    {
+        // decimal, hex and (unless suppressed) binary
+        return (parentFormatter_->IsBinaryFmtSuppressed()) ? 2 : 3;
+    }
     size_t getCompareHash() const override
     {
         return std::hash<size_t>()(width_ + static_cast<size_t>(isSigned_));
     }
     void getTitleRow(std::vector<FmtType::FmtColumn> &titleRow1, std::vector<FmtType::FmtColumn> &titleRow2,
                      std::vector<FmtType::FmtColumn> &underscoreRow) const override;
+    void getColumnWidths(std::vector<size_t> &maxWidths) const override;
+
+    // Parses each of the values. This is the whole cost of the text, shared by every int type that formats them.
+    static void parseBatch(const std::string_view *values, size_t count, ParsedInt *parsed);
+
+    // formatBatch() from values that were already parsed by parseBatch(). The numbers in between come from scratch.
+    ResultCounts formatParsedBatch(const ParsedInt *parsed, size_t count, FmtColumnData *cols,
+                                   std::pmr::memory_resource *scratch) const;
 private:
-    enum class ErrType : uint8_t {FmtErrNone = 0, FmtErrRange = 1, FmtErrInvalid = 2};
+    static const size_t MAX_DEC_LEN = 24;  // room for the longest decimal of any width, sign included
+    // Stack space for the parsed numbers of one formatBatch() call, which has no scratch of the caller's to use. A
+    // batch of fmttool's size (4096 values of up to 8 bytes plus an error code each) fits, so it never touches the
+    // heap. A bigger batch spills over to it.
+    static const size_t BATCH_SCRATCH_SIZE = 40 * 1024;
+
+    static const std::string &getErrString(ErrType err)
+    {
+        return (err == ErrType::FmtErrRange) ? OUT_OF_RANGE : INVALID;
+    }
+
+    // Parse the digits of the value (sign and base prefix included) into an unsigned magnitude. Never throws.
+    static ErrType parseMagnitude(std::string_view value, bool &isNegative, unsigned long long &magnitude);
+
+    // parseMagnitude() plus what ParsedInt keeps about how the number was written
+    static void parseInt(std::string_view value, ParsedInt &parsed);
 
-    // Convert to the target number type by calling appropriate std::sto* function.
-    // Only supports int, long int, and long long int.
-    // All other types are not allowed, therefore we mark the generic non-specialized version as deleted.
-    template <typename I>
-    I stringToNum(const std::string &value, ErrType &err) = delete;
+    // The bit pattern of the value, zero extended to 64 bits. This is what the hex and binary kernels render.
+    template <typename T>
+    static uint64_t toRawBits(T valueAsType)
+    {
+        return static_cast<uint64_t>(static_cast<typename std::make_unsigned<T>::type>(valueAsType));
+    }
 
+    // The tables for the 8 and 16-bit types (see IntTables). Null for the wider ones, which render as they go.
     template <typename T>
-    void fmtNumToHex(std::vector<FmtType::FmtColumn> &formattedCols, T valueAsType);
+    static const IntTables *getTables()
+    {
+        return (sizeof(T) <= 2) ? &IntTables::get() : nullptr;
+    }
+
+    // The text of one valid value. These take the tables from getTables<T>(): the 8 and 16-bit types copy from them,
+    // and the others use std::to_chars and the kernels. writeDec() needs MAX_DEC_LEN of room and returns the length.
+    template <typename T>
+    static size_t writeDec(char *dst, T valueAsType, const IntTables *tables);
+    template <typename T>
+    static void writeHexDigits(char *dst, T valueAsType, const IntTables *tables);
+    template <typename T>
+    static void writeBinDigits(char *dst, T valueAsType, const IntTables *tables);
+
+    // Range checks a parsed value for the target type T, with the rules of the intermediate type I.
+    template <typename T, typename I>
+    T parseValue(const ParsedInt &parsed, ErrType &err) const;
+
+    template <typename T, typename I>
+    ResultCounts formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const;
 
     template <typename T, typename I>
-    void format(std::vector<FmtType::FmtColumn> &formattedCols, const std::string &value);
+    ResultCounts formatParsedBatch(const ParsedInt *parsed, size_t count, FmtColumnData *cols,
+                                   std::pmr::memory_resource *scratch) const;
+
+    template <typename T>
+    ResultCounts formatRawBatch(const uint64_t *rawValues, size_t count, size_t rawBits, FmtColumnData *cols,
+                                std::pmr::memory_resource *scratch) const;
+
+    // The column rendering shared by the batch functions, from numbers that are already parsed and range checked.
+    // Counts the errors on the way.
+    template <typename T>
+    ResultCounts renderBatch(const T *nums, const ErrType *errs, size_t count, FmtColumnData *cols) const;
+
+    // The FormatBatchFn for one width and signedness. See getFormatBatchFn()
+    template <typename T, typename I>
+    static ResultCounts formatBatchFn(const FmtType &fmtType, const std::string_view *values, size_t count,
+                                      FmtColumnData *cols)
+    {
+        return static_cast<const IntType &>(fmtType).formatBatch<T, I>(values, count, cols);
+    }
+
+    // The formatParsedBatch() instance for one width and signedness, picked the same way as getFormatBatchFn()
+    using FormatParsedFn = ResultCounts (*)(const IntType &intType, const ParsedInt *parsed, size_t count,
+                                            FmtColumnData *cols, std::pmr::memory_resource *scratch);
+    FormatParsedFn getFormatParsedFn() const;
+
+    template <typename T, typename I>
+    static ResultCounts formatParsedFn(const IntType &intType, const ParsedInt *parsed, size_t count,
+                                       FmtColumnData *cols, std::pmr::memory_resource *scratch)
+    {
+        return intType.formatParsedBatch<T, I>(parsed, count, cols, scratch);
+    }
 
     size_t width_;
     bool isSigned_;
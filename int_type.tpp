@@ -2,98 +2,196 @@
 // Put in this file to separate implementation from the class
 
 // A note on the formatting:
-// The conversion functions: std::stoi, std::stol, std::stoull convert to an integer width that might be different from
-// the width we want.
-// For example, std::stoi creates a signed 32-bit integer as a result. But if our target type is int16_t, then we
-// cannot rely on the std::out_of_range exception to correctly catch range violations here.
-// Thus, we also add additional checks on the limits if the out_of_range didn't catch it.
-// Caller must choose the correct version that uses a type that is large enough for the target type we are converting to
-// The caller function IntType::format(...) computes the widths and choose correct function to call, using the second
-// template arg to decide which std::sto* function to call.
-// Example: format<int16_t, int>(..) will create a target type of int16_t, and it will use stoi function that returns
-// "int" datatype as an intermediate value.
-// Thus, after capturing the number into the intermediate type, it must do range checking before finalizing the value
-// to the real target type.
+// Each token is parsed just once, by parseInt(), into a ParsedInt whose 128-bit value holds any 64-bit magnitude with
+// its sign. That one parse serves every width: -i 8 -i 16 -i 32 -i 64 -u 64 used to parse the same token five times.
+// What is left per width is the range check in parseValue<T, I>(). T is the target type. I is the intermediate type
+// that the parse used to be done in (int for 8 and 16 bits, long int for 32, long long int and unsigned long long int
+// for 64), and the check still follows its rules, as the intermediate's range could catch things that T's can't:
+// the value must fit in I first, then in T.
+// Example: parseValue<int16_t, int>(..) checks that the number fits an int, and then that it fits an int16_t.
 //
 // Rules for negative numbers when user provides hex input:
 // If the number was a hex input, we allow the user to produce a negative number if the hex input has the correct byte
 // size for the type (and the number is in fact a negative number). For example:
 // 0xfe is -2 for int8_t. But, 0x00fe is 254 for int16_t, even though 0xfe and 0x00fe is the same number numerically.
 // In other words, assume that the user wants to see the negative if they give the exact byte size matching.
+//
+// The unsigned 64-bit intermediate had no bigger type to check against. Like std::stoull it wraps a negative number
+// to a big positive one, except for a token that starts with '-', which is out of range.
 
 template <typename T, typename I>
-void IntType::format(std::vector<FmtType::FmtColumn> &formattedCols, const std::string &value)
+T IntType::parseValue(const ParsedInt &parsed, ErrType &err) const
 {
-    ErrType err = ErrType::FmtErrNone;
-    T valueAsType = 0;
+    static_assert(std::numeric_limits<T>::digits <= std::numeric_limits<I>::digits,
+                  "Type too large for formatting. The intermediate type must be at least as wide as the number type.");
 
-    if (std::numeric_limits<T>::digits > std::numeric_limits<I>::digits) {
-        std::string errMsg("Type too large for formatting. Number type width: ");
-        errMsg += std::to_string(std::numeric_limits<T>::digits) + " and std::sto* width: "
-            + std::to_string(std::numeric_limits<I>::digits);
-        THROW_FMT_EXCEPTION(errMsg);        
+    err = parsed.err;
+    I intValue = 0;
+    if (std::is_unsigned<I>::value) {
+        if (parsed.leadingMinus) {
+            err = ErrType::FmtErrRange;
+        } else if (err == ErrType::FmtErrNone) {
+            intValue = static_cast<I>(parsed.value);  // a sign after white space wraps
+        }
+    } else if (err == ErrType::FmtErrNone) {
+        if (parsed.value >= std::numeric_limits<I>::min() && parsed.value <= std::numeric_limits<I>::max()) {
+            intValue = static_cast<I>(parsed.value);
+        } else if (std::is_same<I, long long int>::value && parsed.hexPrefix) {
+            // Special case for a hex number
+            // The parse gives the numerical value of the hex, not the bit representation of it. For example, the
+            // number 0x8000000000000000 is a huge positive number that is too big for the 64-bit int type.
+            // But this same hex number IS a valid number for 64-bit int. It's the number -9223372036854775808.
+            // The other signed intermediates always had a bigger bitwidth to land in and go through the exact width
+            // rule below instead. No such luck for the 64-bit dudes, so the bits are taken as they are.
+            intValue = static_cast<I>(static_cast<unsigned long long>(parsed.value));
+        } else {
+            err = ErrType::FmtErrRange;
+        }
     }
 
-    // call the atoi wrapper using the type size specification template arg.
-    // This is not the final number, just the result of the atoi call representated as the type from the atoi call.
-    I intValue = stringToNum<I>(value, err);
-
     // down cast the intermediate value to the target type.  This is only safe if its in the valid type range, and
     // also if we meet the conditions for hex input bit width.
     if (err == ErrType::FmtErrNone) {
-        if ((isSigned_ && value.compare(0,2, "0x") == 0 && value[2] != '0' && ((value.size() - 2) / 2) == sizeof(T)) ||
+        if ((isSigned_ && parsed.hexBytes == sizeof(T)) ||
             intValue >= std::numeric_limits<T>::min() && intValue <= std::numeric_limits<T>::max()) {
-            valueAsType = intValue;
-        } else {
-            err = ErrType::FmtErrRange;
+            return static_cast<T>(intValue);
         }
+        err = ErrType::FmtErrRange;
     }
+    return 0;
+}
 
-    // First column is the base 10 version of the data
-    if (err == ErrType::FmtErrRange) {
-        formattedCols.emplace_back(OUT_OF_RANGE, OUT_OF_RANGE.size());
-    } else if (err == ErrType::FmtErrInvalid) {
-        formattedCols.emplace_back(INVALID, INVALID.size());
-    } else {
-        std::string formattedData = std::to_string(valueAsType);
-        formattedCols.emplace_back(formattedData, formattedData.size());
+template <typename T, typename I>
+FmtType::ResultCounts IntType::formatBatch(const std::string_view *values, size_t count, FmtColumnData *cols) const
+{
+    // First parse the whole batch. Then each column is rendered in its own loop over the parsed numbers, which keeps
+    // each loop small and doing the same thing over and over.
+    alignas(std::max_align_t) char scratch[BATCH_SCRATCH_SIZE];
+    std::pmr::monotonic_buffer_resource arena(scratch, sizeof(scratch));
+    std::pmr::vector<T> nums(count, &arena);
+    std::pmr::vector<ErrType> errs(count, &arena);
+    for (size_t i = 0; i < count; ++i) {
+        ParsedInt parsed;
+        parseInt(values[i], parsed);
+        nums[i] = parseValue<T, I>(parsed, errs[i]);
     }
+    return renderBatch<T>(nums.data(), errs.data(), count, cols);
+}
 
-    // The next column will be the hex format of the number. Ensure leading zeros match the bitwidth.
-    if (err == ErrType::FmtErrRange) {
-        formattedCols.emplace_back(OUT_OF_RANGE, OUT_OF_RANGE.size());
-    } else if (err == ErrType::FmtErrInvalid) {
-        formattedCols.emplace_back(INVALID, INVALID.size());
-    } else {
-        fmtNumToHex<T>(formattedCols, valueAsType);
+template <typename T, typename I>
+FmtType::ResultCounts IntType::formatParsedBatch(const ParsedInt *parsed, size_t count, FmtColumnData *cols,
+                                                 std::pmr::memory_resource *scratch) const
+{
+    std::pmr::vector<T> nums(count, scratch);
+    std::pmr::vector<ErrType> errs(count, scratch);
+    for (size_t i = 0; i < count; ++i) {
+        nums[i] = parseValue<T, I>(parsed[i], errs[i]);
     }
+    return renderBatch<T>(nums.data(), errs.data(), count, cols);
+}
 
-    if (!parentTool_->IsBinaryFmtSuppressed()) {
-        // Third column is the binary representation of the number
-        if (err == ErrType::FmtErrRange) {
-            formattedCols.emplace_back(OUT_OF_RANGE, OUT_OF_RANGE.size());
-        } else if (err == ErrType::FmtErrInvalid) {
-            formattedCols.emplace_back(INVALID, INVALID.size());    
+template <typename T>
+FmtType::ResultCounts IntType::formatRawBatch(const uint64_t *rawValues, size_t count, size_t rawBits,
+                                              FmtColumnData *cols, std::pmr::memory_resource *scratch) const
+{
+    // No parsing at all, just the range check. This gives the same answer as the record's hex text would: a value
+    // that fits is taken as is, and a record of exactly our width is taken as the bits of a signed number (the
+    // hex-negative rule).
+    std::pmr::vector<T> nums(count, scratch);
+    std::pmr::vector<ErrType> errs(count, ErrType::FmtErrNone, scratch);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t raw = rawValues[i];
+        if (raw <= static_cast<uint64_t>(std::numeric_limits<T>::max()) || (isSigned_ && rawBits == sizeof(T) * 8)) {
+            nums[i] = static_cast<T>(raw);
         } else {
-            // Quick way to see the binary is to convert to bitset and then display that.
-            std::bitset<sizeof(T) * 8> binValue(valueAsType);
-            std::string formattedData = binValue.to_string();
-            formattedCols.emplace_back(formattedData, formattedData.size());        
+            nums[i] = 0;
+            errs[i] = ErrType::FmtErrRange;
         }
     }
+    return renderBatch<T>(nums.data(), errs.data(), count, cols);
 }
 
 template <typename T>
-void IntType::fmtNumToHex(std::vector<FmtType::FmtColumn> &formattedCols, T valueAsType)
+FmtType::ResultCounts IntType::renderBatch(const T *nums, const ErrType *errs, size_t count,
+                                           FmtColumnData *cols) const
 {
-    std::stringstream ss;
-    // Each byte of the integer type takes 2 characters of width
-    // Examples:
-    // The number 4 in hex for an int8_t is: 0x04  (width of 2 characters)
-    // The number 4 in hex for an int32_t is: 0x00000004 (width of 8 characters)
-    // So the width is computed as sizeof(T)*2 which will create the leading zeros for us.
-    // Since the hex format will also contain the characters "0x", that's 2 more bytes to add.
-    ss << "0x" << std::hex << std::setw(sizeof(T)*2) << std::setfill('0') << valueAsType;
-    std::string formattedData = ss.str();
-    formattedCols.emplace_back(formattedData, formattedData.size());
+    const IntTables *tables = getTables<T>();
+
+    // Base 10, written straight into the column. The errors are counted here, once.
+    ResultCounts results;
+    FmtColumnData &decCol = cols[0];
+    decCol.reserve(count, count * MAX_DEC_LEN);
+    for (size_t i = 0; i < count; ++i) {
+        if (errs[i] != ErrType::FmtErrNone) {
+            decCol.append(getErrString(errs[i]));
+            if (errs[i] == ErrType::FmtErrRange) {
+                ++results.outOfRange;
+            } else {
+                ++results.invalid;
+            }
+        } else {
+            char *dst = decCol.getCellBuffer(MAX_DEC_LEN);
+            decCol.commitCell(writeDec(dst, nums[i], tables));
+        }
+    }
+
+    // Hex, written by the kernel (or the tables) straight into the column
+    const size_t hexWidth = sizeof(T) * 2 + 2;
+    FmtColumnData &hexCol = cols[1];
+    hexCol.reserve(count, count * std::max(hexWidth, OUT_OF_RANGE.size()));
+    for (size_t i = 0; i < count; ++i) {
+        if (errs[i] != ErrType::FmtErrNone) {
+            hexCol.append(getErrString(errs[i]));
+        } else {
+            char *dst = hexCol.appendCell(hexWidth);
+            dst[0] = '0';
+            dst[1] = 'x';
+            writeHexDigits(dst + 2, nums[i], tables);
+        }
+    }
+
+    // Bin, written by the kernel (or the tables) straight into the column
+    if (!parentFormatter_->IsBinaryFmtSuppressed()) {
+        const size_t binWidth = sizeof(T) * 8;
+        FmtColumnData &binCol = cols[2];
+        binCol.reserve(count, count * std::max(binWidth, OUT_OF_RANGE.size()));
+        for (size_t i = 0; i < count; ++i) {
+            if (errs[i] != ErrType::FmtErrNone) {
+                binCol.append(getErrString(errs[i]));
+            } else {
+                writeBinDigits(binCol.appendCell(binWidth), nums[i], tables);
+            }
+        }
+    }
+    return results;
+}
+
+template <typename T>
+size_t IntType::writeDec(char *dst, T valueAsType, const IntTables *tables)
+{
+    if constexpr (sizeof(T) <= 2) {
+        return tables->writeDec(dst, valueAsType);
+    } else {
+        return std::to_chars(dst, dst + MAX_DEC_LEN, valueAsType).ptr - dst;
+    }
+}
+
+template <typename T>
+void IntType::writeHexDigits(char *dst, T valueAsType, const IntTables *tables)
+{
+    if constexpr (sizeof(T) <= 2) {
+        tables->writeHex(dst, static_cast<uint16_t>(toRawBits(valueAsType)), sizeof(T));
+    } else {
+        FmtKernels::writeHex(dst, toRawBits(valueAsType), sizeof(T));
+    }
+}
+
+template <typename T>
+void IntType::writeBinDigits(char *dst, T valueAsType, const IntTables *tables)
+{
+    if constexpr (sizeof(T) <= 2) {
+        tables->writeBin(dst, static_cast<uint16_t>(toRawBits(valueAsType)), sizeof(T));
+    } else {
+        FmtKernels::writeBin(dst, toRawBits(valueAsType), sizeof(T) * 8);
+    }
 }
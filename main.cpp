@@ -1,55 +1,42 @@
-#include <cctype>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 #include "fmt_tool.h"
 #include "fmt_exception.h"
 
-bool IsAnySpace(const std::string value)
-{
-    for (int i = 0; i< value.size(); ++i) {
-        if (std::isspace(value[i])) {
-            return true;
-        }
-    }
-    return false;
-}
-
 int main(int argc, char **argv)
 {
-    std::stringstream args;
     auto fmtTool = std::make_unique<FmtTool>();    
-    if (argc > 1) {
-        for (int i = 1; i < argc; ++i) {
-            std::string tok = argv[i];
-            // When a quoted string is inputted from the shell, the quotes are gone but argv[i]
-            // can contain white space characters.
-            if (IsAnySpace(tok)) {
-                // There was a space in this argument.
-                // wrap this string into an enclosed delimiter. Later when this is parsed properly, it will remain
-                // together as a compound string.  We'll use STX and ETX non-printable characters for this so that
-                // that the user wont have those inside their strings naturally
-                std::string newTok("\2");
-                newTok += tok + "\3";
-                args << " " << newTok;
-            } else {
-                args << " " << tok;
-            }
-        }
-    } else {
-        // Make a default set of formatting rules if the user did not give any args
-        args << FmtTool::DFT_ARGS;
-    }
-
     try {
-        fmtTool->parseArgs(&args);
+        if (argc > 1) {
+            // Each arg is passed on as is. When a quoted string is inputted from the shell, the quotes are gone but
+            // argv[i] still holds the white space, so the whole string stays one value.
+            std::vector<std::string> args(argv + 1, argv + argc);
+            fmtTool->parseArgs(args);
+        } else {
+            // Make a default set of formatting rules if the user did not give any args
+            std::stringstream args(FmtTool::DFT_ARGS);
+            fmtTool->parseArgs(&args);
+        }
         if (fmtTool->showHelp()) {
             return 0;
         }
+        if (fmtTool->serve()) {
+            return 0;  // ran as a server until stopped
+        }
+        bool allFormatted = true;
+        if (fmtTool->formatFiles(allFormatted)) {
+            return (allFormatted) ? 0 : 1;  // more than one -f file, each formatted by a FmtTool of its own
+        }
         fmtTool->executeFormatting();
         fmtTool->displayResultTable();
     } catch (const std::exception &e) {
+        // Anything already formatted goes out ahead of the error.
+        fmtTool->flushOutput();
         std::cout << e.what() << std::endl;
+        return 1;
     }
 
     return 0;
@@ -0,0 +1,51 @@
+#include "mapped_file.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fmt_exception.h"
+
+MappedFile::MappedFile(const std::string &fileName) : fileName_(fileName), data_(nullptr), size_(0)
+{
+    int fd = open(fileName_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        THROW_FMT_EXCEPTION("Unable to open input file " + fileName_ + ": " + std::strerror(errno));
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        std::string errMsg = std::strerror(errno);
+        close(fd);
+        THROW_FMT_EXCEPTION("Unable to stat input file " + fileName_ + ": " + errMsg);
+    }
+    if (!S_ISREG(fileStat.st_mode)) {
+        close(fd);
+        THROW_FMT_EXCEPTION("Input file " + fileName_ + " is not a regular file. (Pipe it in on stdin instead)");
+    }
+
+    // mmap doesn't allow a 0 length mapping. An empty file just has no data.
+    size_ = static_cast<size_t>(fileStat.st_size);
+    if (size_ > 0) {
+        void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::string errMsg = std::strerror(errno);
+            close(fd);
+            THROW_FMT_EXCEPTION("Unable to map input file " + fileName_ + ": " + errMsg);
+        }
+        // We read front to back once. Let the kernel read ahead aggressively and drop pages behind us.
+        madvise(mapped, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(mapped);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+}
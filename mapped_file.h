@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A read-only memory mapping of a whole file. The contents can be tokenized in place, so values handed out as
+// string_views into the mapping never need to be copied. The mapping lives until this object is destroyed.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view getData() const
+    {
+        return std::string_view(data_, size_);
+    }
+
+    const std::string &getFileName() const
+    {
+        return fileName_;
+    }
+
+private:
+    std::string fileName_;
+    const char *data_;
+    size_t size_;
+};
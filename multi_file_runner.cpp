@@ -0,0 +1,157 @@
+#include "multi_file_runner.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include "fmt_exception.h"
+#include "fmt_tool.h"
+
+MultiFileRunner::MultiFileRunner(const std::vector<std::string> &args, const std::vector<std::string> &fileNames,
+                                 int outFd) : args_(args), jobs_(fileNames.size()), out_(outFd), nextJob_(0)
+{
+    for (size_t i = 0; i < fileNames.size(); ++i) {
+        jobs_[i].fileName = fileNames[i];
+    }
+}
+
+MultiFileRunner::~MultiFileRunner()
+{
+    for (size_t i = 1; i < jobs_.size(); ++i) {
+        if (jobs_[i].outFd >= 0) {
+            close(jobs_[i].outFd);
+        }
+    }
+}
+
+bool MultiFileRunner::run()
+{
+    if (jobs_.empty()) {
+        return true;
+    }
+    // The temporary files are unlinked right away, so they go away by themselves however the run ends.
+    jobs_[0].outFd = out_.getFd();
+    const char *tmpDir = std::getenv("TMPDIR");
+    for (size_t i = 1; i < jobs_.size(); ++i) {
+        std::string fileName = std::string((tmpDir != nullptr && *tmpDir != '\0') ? tmpDir : "/tmp") +
+                               "/fmttool_out_XXXXXX";
+        jobs_[i].outFd = mkstemp(&fileName[0]);
+        if (jobs_[i].outFd < 0) {
+            THROW_FMT_EXCEPTION("Unable to create the temporary file " + fileName + ": " + std::strerror(errno));
+        }
+        unlink(fileName.c_str());
+    }
+
+    writeHeader(jobs_[0]);
+    out_.flush();  // ahead of the first file's own output, which goes straight to the fd
+    size_t numThreads = std::min<size_t>(jobs_.size(), std::max(1U, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.emplace_back([this]() { runWorker(); });
+    }
+
+    // Hand each file's output on in order, as soon as it and the ones before it are done.
+    try {
+        for (size_t i = 0; i < jobs_.size(); ++i) {
+            if (i > 0) {
+                writeHeader(jobs_[i]);
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                doneCond_.wait(lock, [this, i]() { return jobs_[i].done; });
+            }
+            if (i > 0) {
+                copyOut(jobs_[i].outFd);
+            }
+        }
+        out_.flush();
+    } catch (...) {
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        throw;
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return std::none_of(jobs_.begin(), jobs_.end(), [](const FileJob &job) { return job.failed; });
+}
+
+void MultiFileRunner::runWorker()
+{
+    while (true) {
+        size_t jobNum;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (nextJob_ == jobs_.size()) {
+                return;
+            }
+            jobNum = nextJob_++;
+        }
+        formatFile(jobs_[jobNum]);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_[jobNum].done = true;
+        }
+        doneCond_.notify_all();
+    }
+}
+
+void MultiFileRunner::formatFile(FileJob &job)
+{
+    // The same steps as main(), including where an error goes: into this file's output, after whatever of it was
+    // already formatted. One bad file doesn't stop the others, but the run fails at the end.
+    std::unique_ptr<FmtTool> fmtTool;
+    try {
+        fmtTool = std::make_unique<FmtTool>(job.outFd);
+        std::vector<std::string> args = args_;
+        args.push_back("-f");
+        args.push_back(job.fileName);
+        fmtTool->parseArgs(args);
+        fmtTool->executeFormatting();
+        fmtTool->displayResultTable();
+    } catch (const std::exception &e) {
+        job.failed = true;
+        try {
+            if (fmtTool) {
+                fmtTool->flushOutput();
+            }
+            OutputWriter errOut(job.outFd);
+            errOut.write(e.what());
+            errOut.write("\n");
+            errOut.flush();
+        } catch (...) {
+            // Nowhere left to report it
+        }
+    }
+}
+
+void MultiFileRunner::writeHeader(const FileJob &job)
+{
+    out_.write("==> ");
+    out_.write(job.fileName);
+    out_.write(" <==\n");
+}
+
+void MultiFileRunner::copyOut(int fd)
+{
+    // A big block at a time, through the writer (which sends blocks this size on without copying them)
+    std::vector<char> buf(OutputWriter::DFT_BUF_SIZE);
+    off_t pos = 0;
+    while (true) {
+        ssize_t numRead = pread(fd, buf.data(), buf.size(), pos);
+        if (numRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numRead < 0) {
+            THROW_FMT_EXCEPTION(std::string("Unable to read back a temporary output file: ") + std::strerror(errno));
+        }
+        if (numRead == 0) {
+            break;
+        }
+        out_.write(std::string_view(buf.data(), static_cast<size_t>(numRead)));
+        pos += numRead;
+    }
+}
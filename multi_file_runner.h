@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "output_writer.h"
+
+// Formats several input files in one run (fmttool -f a.txt -f b.txt ...). Each file gets its own FmtTool, set up from
+// the same args, so each has its own format types and its own result table, and the files are formatted at the same
+// time on a pool of threads (one per cpu, at most one per file).
+// The output is still one file after the other, in the order they were given, each after a "==> name <==" header
+// line. The first file is written straight to the output as it is formatted. The others write to temporary files,
+// which are copied out in turn once the files before them are done. So the run takes about as long as the biggest
+// file, not all of them added up.
+class MultiFileRunner {
+public:
+    // args are the fmttool args without any -f. The output goes to outFd.
+    MultiFileRunner(const std::vector<std::string> &args, const std::vector<std::string> &fileNames, int outFd);
+    ~MultiFileRunner();
+    MultiFileRunner(const MultiFileRunner &) = delete;
+    MultiFileRunner &operator=(const MultiFileRunner &) = delete;
+
+    // Returns false if any of the files failed (its error is in its part of the output).
+    bool run();
+
+private:
+    struct FileJob {
+        std::string fileName;
+        int outFd = -1;     // where its FmtTool writes: the output for the first file, a temporary file for the rest
+        bool done = false;  // formatted, and everything is written to outFd
+        bool failed = false;  // stopped by an error
+    };
+
+    void runWorker();
+    void formatFile(FileJob &job);
+    void writeHeader(const FileJob &job);
+    void copyOut(int fd);
+
+    std::vector<std::string> args_;
+    std::vector<FileJob> jobs_;
+    OutputWriter out_;
+    size_t nextJob_;  // the next file for a worker to take
+    std::mutex mutex_;
+    std::condition_variable doneCond_;
+};
@@ -0,0 +1,100 @@
+#include "output_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <sys/uio.h>
+#include "fmt_exception.h"
+
+const size_t OutputWriter::DFT_BUF_SIZE = 1 << 20;  // 1MB
+
+OutputWriter::OutputWriter(int fd, size_t bufSize) : fd_(fd), buf_(bufSize), used_(0)
+{
+}
+
+OutputWriter::~OutputWriter()
+{
+    // Destructors must not throw. If the final flush fails there is nobody left to tell anyway.
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void OutputWriter::write(std::string_view data)
+{
+    if (data.size() <= buf_.size() - used_) {
+        std::memcpy(buf_.data() + used_, data.data(), data.size());
+        used_ += data.size();
+        return;
+    }
+    if (data.size() < buf_.size()) {
+        flush();
+        std::memcpy(buf_.data(), data.data(), data.size());
+        used_ = data.size();
+        return;
+    }
+    // Bigger than the whole buffer. Rather than copy it through the buffer in pieces, send the buffered data and the
+    // new data together in one writev.
+    writeToFd(buf_.data(), used_, data.data(), data.size());
+    used_ = 0;
+}
+
+void OutputWriter::fill(char c, size_t count)
+{
+    while (count > 0) {
+        if (used_ == buf_.size()) {
+            flush();
+        }
+        size_t chunk = std::min(count, buf_.size() - used_);
+        std::memset(buf_.data() + used_, c, chunk);
+        used_ += chunk;
+        count -= chunk;
+    }
+}
+
+void OutputWriter::flush()
+{
+    if (used_ > 0) {
+        writeToFd(buf_.data(), used_, nullptr, 0);
+        used_ = 0;
+    }
+}
+
+void OutputWriter::writeToFd(const char *data, size_t size, const char *extraData, size_t extraSize)
+{
+    struct iovec vec[2];
+    int numVecs = 0;
+    if (size > 0) {
+        vec[numVecs].iov_base = const_cast<char *>(data);
+        vec[numVecs].iov_len = size;
+        ++numVecs;
+    }
+    if (extraSize > 0) {
+        vec[numVecs].iov_base = const_cast<char *>(extraData);
+        vec[numVecs].iov_len = extraSize;
+        ++numVecs;
+    }
+    struct iovec *next = vec;
+
+    // The OS is allowed to take less than we gave it. Keep going until it has it all.
+    while (numVecs > 0) {
+        ssize_t written = writev(fd_, next, numVecs);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            THROW_FMT_EXCEPTION(std::string("Unable to write output: ") + std::strerror(errno));
+        }
+        size_t remaining = static_cast<size_t>(written);
+        while (numVecs > 0 && remaining >= next->iov_len) {
+            remaining -= next->iov_len;
+            ++next;
+            --numVecs;
+        }
+        if (numVecs > 0) {
+            next->iov_base = static_cast<char *>(next->iov_base) + remaining;
+            next->iov_len -= remaining;
+        }
+    }
+}
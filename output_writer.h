@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+// Buffered output straight to a file descriptor.
+// The rows are built up in one large buffer that is reused over and over, and handed to the OS in big chunks with
+// write/writev. There is no iostream underneath, so there are no per-call stream state changes (setw, setfill) and
+// no locale or sentry work for every cell.
+class OutputWriter {
+public:
+    static const size_t DFT_BUF_SIZE;
+
+    explicit OutputWriter(int fd = STDOUT_FILENO, size_t bufSize = DFT_BUF_SIZE);
+    ~OutputWriter();
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    void write(std::string_view data);
+
+    // Writes count copies of the character c
+    void fill(char c, size_t count);
+
+    // Writes the data right aligned in a field of the given width (the same as std::setw). Data that is wider than
+    // the field is written in full.
+    void writePadded(std::string_view data, size_t width, char fillChar = ' ')
+    {
+        if (width > data.size()) {
+            fill(fillChar, width - data.size());
+        }
+        write(data);
+    }
+
+    // Hands everything buffered so far to the OS.
+    void flush();
+
+    int getFd() const
+    {
+        return fd_;
+    }
+
+private:
+    void writeToFd(const char *data, size_t size, const char *extraData, size_t extraSize);
+
+    int fd_;
+    std::vector<char> buf_;
+    size_t used_;
+};
@@ -0,0 +1,128 @@
+#!/bin/bash
+
+# End to end performance runs of fmttool over synthetic corpora (see fmt_corpus.cpp). This is what runtests.sh is
+# not: big inputs, the usual sets of flags, and numbers instead of output to look at.
+#
+# Usage: ./perf.sh [scenario name filter]        (or make perf)
+#
+# Each scenario runs PERF_RUNS times (default 3) and keeps the fastest wall time. The tokens and the peak memory come
+# from fmttool's -stats report. Results go to perf_output.json, one scenario per line, so two runs can be diffed. If
+# perf_baseline.json is there, each scenario is also shown next to its baseline. To make the current results the
+# baseline: cp perf_output.json perf_baseline.json
+#
+# The corpora are PERF_SIZE (default 32m) each and go in perf_corpus/. They are only made once per size, and the same
+# size always makes the same corpus.
+
+PERF_SIZE=${PERF_SIZE:-32m}
+PERF_RUNS=${PERF_RUNS:-3}
+CORPUS_DIR=perf_corpus
+OUTPUT=perf_output.json
+BASELINE=perf_baseline.json
+FILTER=$1
+
+# name, then the fmtcorpus args
+CORPORA=(
+    "ints       -mix dec=50,hex=25,neg=15,range=5,invalid=5"
+    "ints_rep   -mix dec=50,hex=25,neg=15,range=5,invalid=5 -repeat 90"
+    "strings    -mix ascii=50,blob=50"
+    "mixed      -mix dec=40,hex=20,neg=15,range=10,invalid=5,ascii=5,blob=5"
+)
+
+# name, corpus, how it is read (file for -f, stdin for a redirect), then the fmttool args
+SCENARIOS=(
+    "int32              ints      file   -i 32"
+    "int32_stdin        ints      stdin  -i 32"
+    "int_all_widths     ints      file   -i 8 -u 8 -i 16 -u 16 -i 32 -u 32 -i 64 -u 64"
+    "int16_nobin        ints      file   -i 16 -nobin"
+    "int32_j4           ints      file   -i 32 -j 4"
+    "int64_stream       ints      file   -i 64 -stream"
+    "int32_csv          ints      file   -i 32 -o csv"
+    "int32_maxmem       ints      file   -i 32 -maxmem 16m"
+    "int32_cache        ints_rep  file   -i 32 -cache 8192"
+    "int32_nocache      ints_rep  file   -i 32"
+    "ascii_binary       strings   file   -a -b"
+    "mixed_all          mixed     file   -i 32 -u 64 -a -b"
+)
+
+set -e
+mkdir -p $CORPUS_DIR
+for corpus in "${CORPORA[@]}"; do
+    read -r name args <<< "$corpus"
+    file=$CORPUS_DIR/${name}_$PERF_SIZE.txt
+    if [ ! -s "$file" ]; then
+        echo "Making $file" >&2
+        ./fmtcorpus -size $PERF_SIZE $args > "$file.tmp"
+        mv "$file.tmp" "$file"
+    fi
+done
+
+stats=$(mktemp)
+trap 'rm -f "$stats"' EXIT
+{
+    echo "{\"size\": \"$PERF_SIZE\", \"runs\": $PERF_RUNS, \"scenarios\": ["
+    first=1
+    for scenario in "${SCENARIOS[@]}"; do
+        read -r name corpus input args <<< "$scenario"
+        if [ -n "$FILTER" ] && [[ "$name" != *"$FILTER"* ]]; then
+            continue
+        fi
+        file=$CORPUS_DIR/${corpus}_$PERF_SIZE.txt
+        best_ns=0
+        max_rss=0
+        for ((run = 0; run < PERF_RUNS; ++run)); do
+            start=$(date +%s%N)
+            if [ "$input" = "stdin" ]; then
+                ./fmttool $args -stats < "$file" > /dev/null 2> "$stats"
+            else
+                ./fmttool $args -stats -f "$file" > /dev/null 2> "$stats"
+            fi
+            ns=$(( $(date +%s%N) - start ))
+            if [ $best_ns -eq 0 ] || [ $ns -lt $best_ns ]; then
+                best_ns=$ns
+            fi
+            rss=$(awk '/peak rss/ {print $3}' "$stats")
+            if [ "${rss:-0}" -gt $max_rss ]; then
+                max_rss=$rss
+            fi
+        done
+        tokens=$(awk '$1 == "tokens" {print $2}' "$stats")
+        if [ $first -eq 0 ]; then
+            echo ","
+        fi
+        first=0
+        awk -v name="$name" -v args="$args" -v input="$input" -v ns=$best_ns -v tokens=${tokens:-0} -v rss=$max_rss \
+            'BEGIN {printf "  {\"name\": \"%s\", \"args\": \"%s\", \"input\": \"%s\", \"wall_s\": %.3f, \"tokens\": %d, " \
+                           "\"tokens_per_s\": %.0f, \"peak_rss_kb\": %d}", name, args, input, ns / 1e9, tokens,
+                           (ns > 0) ? tokens / (ns / 1e9) : 0, rss}'
+    done
+    echo
+    echo "]}"
+} > $OUTPUT
+cat $OUTPUT
+
+# Side by side with the baseline, for the scenarios that are in both
+if [ -f $BASELINE ]; then
+    echo
+    awk 'function field(line, key) {
+             if (match(line, "\"" key "\": (\"[^\"]*\"|[0-9.]+)")) {
+                 value = substr(line, RSTART + length(key) + 4, RLENGTH - length(key) - 4)
+                 gsub(/"/, "", value)
+                 return value
+             }
+             return ""
+         }
+         FNR == 1 { fileNum++ }
+         /"name"/ {
+             name = field($0, "name")
+             if (fileNum == 1) {
+                 baseWall[name] = field($0, "wall_s")
+                 baseRss[name] = field($0, "peak_rss_kb")
+             } else if (name in baseWall) {
+                 wall = field($0, "wall_s")
+                 rss = field($0, "peak_rss_kb")
+                 printf "%-18s wall %8.3fs -> %8.3fs (%+6.1f%%)   peak rss %8d KB -> %8d KB (%+6.1f%%)\n", name,
+                        baseWall[name], wall, (baseWall[name] > 0) ? (wall / baseWall[name] - 1) * 100 : 0,
+                        baseRss[name], rss, (baseRss[name] > 0) ? (rss / baseRss[name] - 1) * 100 : 0
+             }
+         }' $BASELINE $OUTPUT
+fi
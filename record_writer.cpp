@@ -0,0 +1,152 @@
+#include "record_writer.h"
+#include <algorithm>
+#include "fmt_exception.h"
+
+RecordWriter::RecordWriter(OutputWriter &out, Format format) : out_(out), format_(format)
+{
+}
+
+void RecordWriter::writeHeader(const std::vector<std::string> &names)
+{
+    if (format_ == Format::JSONL) {
+        // No header line. Each key is escaped once here rather than for every row.
+        jsonKeys_.clear();
+        for (const auto &name : names) {
+            std::string key = "\"";
+            for (char c : name) {
+                if (c == '"' || c == '\\') {
+                    key += '\\';
+                }
+                key += c;
+            }
+            key += "\":";
+            jsonKeys_.push_back(std::move(key));
+        }
+        return;
+    }
+
+    for (size_t col = 0; col < names.size(); ++col) {
+        if (col > 0) {
+            out_.write((format_ == Format::CSV) ? "," : "\t");
+        }
+        if (format_ == Format::CSV) {
+            writeCsvField(names[col]);
+        } else {
+            writeTsvField(names[col]);
+        }
+    }
+    out_.write("\n");
+}
+
+void RecordWriter::writeBatch(const std::vector<FmtColumnData> &cols)
+{
+    size_t numRows = cols.empty() ? 0 : cols[0].size();
+    switch (format_) {
+        case Format::CSV:
+        case Format::TSV: {
+            const bool isCsv = (format_ == Format::CSV);
+            for (size_t row = 0; row < numRows; ++row) {
+                for (size_t col = 0; col < cols.size(); ++col) {
+                    if (col > 0) {
+                        out_.write(isCsv ? "," : "\t");
+                    }
+                    if (isCsv) {
+                        writeCsvField(cols[col].getCell(row));
+                    } else {
+                        writeTsvField(cols[col].getCell(row));
+                    }
+                }
+                out_.write("\n");
+            }
+            break;
+        }
+        case Format::JSONL: {
+            if (jsonKeys_.size() != cols.size()) {
+                THROW_FMT_EXCEPTION("The number of columns does not match the number of column names.");
+            }
+            for (size_t row = 0; row < numRows; ++row) {
+                out_.write("{");
+                for (size_t col = 0; col < cols.size(); ++col) {
+                    if (col > 0) {
+                        out_.write(",");
+                    }
+                    out_.write(jsonKeys_[col]);
+                    writeJsonString(cols[col].getCell(row));
+                }
+                out_.write("}\n");
+            }
+            break;
+        }
+    }
+}
+
+void RecordWriter::writeCsvField(std::string_view field)
+{
+    // Nearly every field is a plain number or hex string, so look before doing any quoting work.
+    auto needsQuotes = [](char c) { return c == ',' || c == '"' || c == '\n' || c == '\r'; };
+    if (std::none_of(field.begin(), field.end(), needsQuotes)) {
+        out_.write(field);
+        return;
+    }
+    out_.write("\"");
+    size_t start = 0;
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '"') {
+            out_.write(field.substr(start, i + 1 - start));  // the quote itself, then once more below
+            out_.write("\"");
+            start = i + 1;
+        }
+    }
+    out_.write(field.substr(start));
+    out_.write("\"");
+}
+
+void RecordWriter::writeTsvField(std::string_view field)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < field.size(); ++i) {
+        const char *escape = nullptr;
+        switch (field[i]) {
+            case '\t': escape = "\\t"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            case '\\': escape = "\\\\"; break;
+            default: break;
+        }
+        if (escape != nullptr) {
+            out_.write(field.substr(start, i - start));
+            out_.write(escape);
+            start = i + 1;
+        }
+    }
+    out_.write(field.substr(start));
+}
+
+void RecordWriter::writeJsonString(std::string_view text)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    out_.write("\"");
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            continue;  // the common case: written with the rest of the run
+        }
+        out_.write(text.substr(start, i - start));
+        start = i + 1;
+        switch (c) {
+            case '"': out_.write("\\\""); break;
+            case '\\': out_.write("\\\\"); break;
+            case '\n': out_.write("\\n"); break;
+            case '\r': out_.write("\\r"); break;
+            case '\t': out_.write("\\t"); break;
+            default: {
+                char escape[] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf]};
+                out_.write(std::string_view(escape, sizeof(escape)));
+                break;
+            }
+        }
+    }
+    out_.write(text.substr(start));
+    out_.write("\"");
+}
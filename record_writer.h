@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fmt_column.h"
+#include "output_writer.h"
+
+// Writes the formatted rows as machine readable records (the -o csv|tsv|jsonl output) instead of the aligned table.
+// Rows are written as soon as they are formatted and nothing is padded, so there is no width work at all.
+//  - csv:   a header line of column names, then one line per row. Fields holding a comma, quote or line break are
+//           quoted, with quotes doubled (RFC 4180, but with \n line ends).
+//  - tsv:   a header line of column names, then one line per row. Tab, newline, carriage return and backslash in a
+//           field are written as \t, \n, \r and \\.
+//  - jsonl: one JSON object per row, keyed by the column names, with every value a string. Control characters and
+//           bytes above 0x7f are written as \u00XX escapes, so the output is always valid JSON (bytes are taken as
+//           Latin-1).
+class RecordWriter {
+public:
+    enum class Format : int8_t {
+        CSV = 1,
+        TSV = 2,
+        JSONL = 3
+    };
+
+    RecordWriter(OutputWriter &out, Format format);
+    ~RecordWriter() = default;
+
+    // Sets the column names, and writes the header line for the formats that have one.
+    void writeHeader(const std::vector<std::string> &names);
+
+    // Writes every row of the batch. There must be one column per name.
+    void writeBatch(const std::vector<FmtColumnData> &cols);
+
+private:
+    void writeCsvField(std::string_view field);
+    void writeTsvField(std::string_view field);
+    void writeJsonString(std::string_view text);
+
+    OutputWriter &out_;
+    Format format_;
+    std::vector<std::string> jsonKeys_;  // jsonl only: the quoted key and colon for each column, built once
+};
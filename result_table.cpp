@@ -0,0 +1,164 @@
+#include "result_table.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "fmt_exception.h"
+
+// Whole buffer reads and writes of the spill file. A short read or write is just continued.
+static void writeAll(int fd, const void *src, size_t len)
+{
+    const char *pos = static_cast<const char *>(src);
+    while (len > 0) {
+        ssize_t numWritten = write(fd, pos, len);
+        if (numWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            THROW_FMT_EXCEPTION(std::string("Unable to write the spill file: ") + std::strerror(errno));
+        }
+        pos += numWritten;
+        len -= static_cast<size_t>(numWritten);
+    }
+}
+
+static void readAll(int fd, uint64_t filePos, void *dst, size_t len)
+{
+    char *pos = static_cast<char *>(dst);
+    while (len > 0) {
+        ssize_t numRead = pread(fd, pos, len, static_cast<off_t>(filePos));
+        if (numRead <= 0) {
+            if (numRead < 0 && errno == EINTR) {
+                continue;
+            }
+            THROW_FMT_EXCEPTION(std::string("Unable to read the spill file: ") +
+                                ((numRead < 0) ? std::strerror(errno) : "it is short"));
+        }
+        pos += numRead;
+        filePos += static_cast<uint64_t>(numRead);
+        len -= static_cast<size_t>(numRead);
+    }
+}
+
+ResultTable::~ResultTable()
+{
+    closeSpill();
+}
+
+void ResultTable::initColumns(size_t numCols)
+{
+    closeSpill();
+    columns_.clear();
+    columns_.resize(numCols);
+    widths_.assign(numCols, 0);
+    numRows_ = 0;
+    bytesInMemory_ = 0;
+}
+
+void ResultTable::addBatch(const std::vector<FmtColumnData> &batchCols)
+{
+    if (batchCols.size() != columns_.size()) {
+        THROW_FMT_EXCEPTION("Formatted batch does not have the same number of columns as the result table.");
+    }
+    // A whole column of the batch is copied at once
+    for (size_t col = 0; col < columns_.size(); ++col) {
+        if (batchCols[col].size() != batchCols[0].size()) {
+            THROW_FMT_EXCEPTION("Formatted batch columns have different numbers of rows.");
+        }
+        columns_[col].appendColumn(batchCols[col]);
+        widths_[col] = std::max(widths_[col], batchCols[col].getMaxWidth());
+        bytesInMemory_ += batchCols[col].getAllCells().size() + batchCols[col].size() * sizeof(size_t);
+    }
+    numRows_ += (batchCols.empty()) ? 0 : batchCols[0].size();
+    if (maxBytes_ > 0 && bytesInMemory_ >= maxBytes_) {
+        spill();
+    }
+}
+
+void ResultTable::forEachBlock(const BlockFn &blockFn)
+{
+    if (spillFd_ < 0) {
+        blockFn(columns_);
+        return;
+    }
+    // The rows still in memory go out to the file too. Then the blocks are read back, in order, into the memory
+    // that held them.
+    if (!columns_.empty() && columns_[0].size() > 0) {
+        spill();
+    }
+    uint64_t filePos = 0;
+    while (filePos < spillSize_) {
+        readBlock(filePos);
+        blockFn(columns_);
+    }
+    for (auto &column : columns_) {
+        column.clear();
+    }
+}
+
+void ResultTable::spill()
+{
+    // A block is the row count, then for each column: the size of its text, the length of each cell and the text
+    // itself. The lengths are 64 bits, because with -l and -a a single cell can be the hex of a line of any size.
+    if (spillFd_ < 0) {
+        const char *tmpDir = std::getenv("TMPDIR");
+        std::string fileName = std::string((tmpDir != nullptr && *tmpDir != '\0') ? tmpDir : "/tmp") +
+                               "/fmttool_spill_XXXXXX";
+        spillFd_ = mkstemp(&fileName[0]);
+        if (spillFd_ < 0) {
+            THROW_FMT_EXCEPTION("Unable to create the spill file " + fileName + ": " + std::strerror(errno));
+        }
+        unlink(fileName.c_str());  // gone from the directory now, and from the disk once it is closed
+        spillSize_ = 0;
+    }
+    uint64_t numRows = columns_[0].size();
+    writeAll(spillFd_, &numRows, sizeof(numRows));
+    spillSize_ += sizeof(numRows);
+    for (auto &column : columns_) {
+        std::string_view text = column.getAllCells();
+        uint64_t textSize = text.size();
+        cellLens_.resize(numRows);
+        for (size_t row = 0; row < numRows; ++row) {
+            cellLens_[row] = column.getCell(row).size();
+        }
+        writeAll(spillFd_, &textSize, sizeof(textSize));
+        writeAll(spillFd_, cellLens_.data(), numRows * sizeof(uint64_t));
+        writeAll(spillFd_, text.data(), text.size());
+        spillSize_ += sizeof(textSize) + numRows * sizeof(uint64_t) + textSize;
+        column.clear();  // keeps its memory for the next rows
+    }
+    bytesInMemory_ = 0;
+}
+
+void ResultTable::readBlock(uint64_t &filePos)
+{
+    uint64_t numRows;
+    readAll(spillFd_, filePos, &numRows, sizeof(numRows));
+    filePos += sizeof(numRows);
+    for (auto &column : columns_) {
+        uint64_t textSize;
+        readAll(spillFd_, filePos, &textSize, sizeof(textSize));
+        filePos += sizeof(textSize);
+        cellLens_.resize(numRows);
+        readAll(spillFd_, filePos, cellLens_.data(), numRows * sizeof(uint64_t));
+        filePos += numRows * sizeof(uint64_t);
+
+        // The text is read straight into the column, and then the cells are marked off in it one after the other.
+        column.clear();
+        column.reserve(numRows, textSize);
+        readAll(spillFd_, filePos, column.getCellBuffer(textSize), textSize);
+        filePos += textSize;
+        for (size_t row = 0; row < numRows; ++row) {
+            column.commitCell(cellLens_[row]);
+        }
+    }
+}
+
+void ResultTable::closeSpill()
+{
+    if (spillFd_ >= 0) {
+        close(spillFd_);
+        spillFd_ = -1;
+    }
+    spillSize_ = 0;
+}
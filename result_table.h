@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fmt_column.h"
+
+// Storage for the formatted rows that are waiting to be displayed.
+// The table is stored by column rather than by row. Each column keeps all of its cell data back to back in one
+// character arena, plus an array of offsets to find where each cell ends (see FmtColumnData). There is no string
+// object per cell, and no vector per row. The display width of each column is kept up to date as rows are added, so
+// the table never needs a second pass to compute the widths.
+// With a memory limit, rows past the limit are moved out to a temporary file in blocks (the same layout as in memory:
+// per column, the cell lengths then the cell text) and read back a block at a time for display. Only the widths stay
+// in memory for all of the rows, so memory stays the same no matter how many rows there are.
+class ResultTable {
+public:
+    ResultTable() = default;
+    ~ResultTable();
+    ResultTable(const ResultTable &) = delete;
+    ResultTable &operator=(const ResultTable &) = delete;
+
+    // Sets up the given number of empty columns. Any existing data is dropped.
+    void initColumns(size_t numCols);
+
+    // Keep about maxBytes of rows in memory at most, and spill the rest to a temporary file. 0 (the default) keeps
+    // all of the rows in memory.
+    void setMemoryLimit(size_t maxBytes)
+    {
+        maxBytes_ = maxBytes;
+    }
+
+    // Makes a column at least the given width (used for the title rows which are not stored in the table).
+    void widenColumn(size_t col, size_t width)
+    {
+        widths_[col] = std::max(widths_[col], width);
+    }
+
+    // Appends a batch of formatted rows, given as one FmtColumnData per column (all the same length).
+    void addBatch(const std::vector<FmtColumnData> &batchCols);
+
+    size_t getRowCount() const
+    {
+        return numRows_;
+    }
+
+    size_t getColumnCount() const
+    {
+        return columns_.size();
+    }
+
+    size_t getColumnWidth(size_t col) const
+    {
+        return widths_[col];
+    }
+
+    // True if some of the rows are in the temporary file
+    bool hasSpilled() const
+    {
+        return spillFd_ >= 0;
+    }
+
+    // Calls blockFn with all of the rows, in order, a block at a time: one FmtColumnData per column, all the same
+    // length. The columns are only good for the call. Nothing is added or dropped, so this can be done again.
+    using BlockFn = std::function<void(const std::vector<FmtColumnData> &cols)>;
+    void forEachBlock(const BlockFn &blockFn);
+
+private:
+    void spill();
+    void readBlock(uint64_t &filePos);
+    void closeSpill();
+
+    std::vector<FmtColumnData> columns_;  // the rows in memory. All of them, unless some were spilled.
+    std::vector<size_t> widths_;          // display width of each column, over all of the rows
+    size_t numRows_ = 0;
+    size_t maxBytes_ = 0;                 // 0 for no limit
+    size_t bytesInMemory_ = 0;            // cell text and offsets of the rows in columns_
+    int spillFd_ = -1;                    // the temporary file. It is unlinked as soon as it is made.
+    uint64_t spillSize_ = 0;              // bytes written to it
+    std::vector<uint64_t> cellLens_;      // one column of cell lengths, going to or coming from the file
+};
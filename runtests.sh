@@ -42,6 +42,59 @@ echo
 echo "Test ascii input. quoted strings and also escape sequence"
 ./fmttool -a hello goodbye "hello good\"bye\""
 echo
+echo "Test ascii input with bytes above 0x7f. Every byte is 2 hex digits"
+./fmttool -a "$(printf 'caf\xc3\xa9')"
+echo
 echo "Test binary input format to ascii"
 ./fmttool -b 0x68656c6c6f20676f6f64627965
 echo
+echo "Test line mode. Each line is one value, spaces and all"
+printf 'hello world\n\n  two  spaces\r\n' | ./fmttool -l -a
+echo
+echo "Test server mode. Two requests on one connection, each a 4 byte big endian length then the values"
+./fmttool -i 16 -a -serve /tmp/fmttool_test.sock &
+while [ ! -S /tmp/fmttool_test.sock ]; do sleep 0.1; done
+python3 -c '
+import socket, struct
+sock = socket.socket(socket.AF_UNIX)
+sock.connect("/tmp/fmttool_test.sock")
+for request in (b"1 -1 0x8000 70000", b"hi"):
+    sock.sendall(struct.pack(">I", len(request)) + request)
+for request in range(2):
+    size = struct.unpack(">I", sock.recv(4, socket.MSG_WAITALL))[0]
+    print(sock.recv(size, socket.MSG_WAITALL).decode(), end="")
+'
+kill $!
+wait
+echo
+echo "Test that -serve refuses the options it has no use for"
+./fmttool -i 16 -cache 8 -serve /tmp/fmttool_test.sock | grep -v '^File: '
+echo
+echo "Test raw 16 bit records, little endian (the default) then big endian"
+printf '\x01\x00\xff\xff\x00\x80' | ./fmttool -raw 16 -i 16 -u 16
+printf '\x01\x00\xff\xff\x00\x80' | ./fmttool -raw 16 -be -i 16 -u 16
+echo
+echo "Test csv, tsv and jsonl output. Quotes and a comma for csv, a tab for tsv, a control byte for jsonl"
+./fmttool -o csv -a 'say "hi", then' plain
+./fmttool -o tsv -a "$(printf 'a\tb')" c
+./fmttool -o jsonl -i 8 -a "$(printf 'x\x01"y\\')" 5
+echo
+echo "Test cache. 12000 values in 3 batches, 4 distinct, each formatted once. The rows are the same as without it"
+yes "1 2 0x01 300" | head -3000 | ./fmttool -cache 16 -i 8 2>&1 | tail -6
+yes "1 2 0x01 300" | head -3000 | ./fmttool -cache 16 -i 8 2>&1 > /dev/null | grep -q " 4 misses," \
+    && echo "4 misses, one per distinct value"
+cmp <(yes "1 2 0x01 300" | head -3000 | ./fmttool -cache 16 -i 8 2> /dev/null) \
+    <(yes "1 2 0x01 300" | head -3000 | ./fmttool -i 8) && echo "same rows as without -cache"
+echo
+echo "Test maxmem. Most of the 80001 rows are spilled to a temporary file and read back. The table doesn't change"
+seq -40000 40000 | ./fmttool -i 16 -maxmem 64k | sed -n '1,4p;7770,7772p;80003,80004p'
+cmp <(seq -40000 40000 | ./fmttool -i 16 -maxmem 64k) <(seq -40000 40000 | ./fmttool -i 16) \
+    && echo "same table as without -maxmem"
+echo
+echo "Test several files. The one that doesn't exist fails in its place, the others still go, and the exit status is 1"
+printf '1 2\n' > /tmp/fmttool_a.txt
+printf '0x80\n' > /tmp/fmttool_b.txt
+./fmttool -i 8 -f /tmp/fmttool_a.txt -f /tmp/fmttool_missing.txt -f /tmp/fmttool_b.txt | grep -v '^File: '
+echo "exit status ${PIPESTATUS[0]}"
+rm -f /tmp/fmttool_a.txt /tmp/fmttool_b.txt
+echo